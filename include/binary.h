@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace kepub {
+
+// Native byte order, only meant for caches that are written and read by the
+// same build
+
+template <typename T>
+void write_binary(std::string &out, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+inline void write_binary(std::string &out, const std::string &str) {
+  write_binary(out, static_cast<std::uint64_t>(std::size(str)));
+  out.append(str);
+}
+
+template <typename T>
+void write_binary(std::string &out, const std::vector<T> &vec) {
+  write_binary(out, static_cast<std::uint64_t>(std::size(vec)));
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    out.append(reinterpret_cast<const char *>(std::data(vec)),
+               std::size(vec) * sizeof(T));
+  } else {
+    for (const auto &item : vec) {
+      write_binary(out, item);
+    }
+  }
+}
+
+// Returns false if the input is too short, which leaves value unspecified
+template <typename T>
+[[nodiscard]] bool read_binary(std::string_view &in, T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if (std::size(in) < sizeof(T)) {
+    return false;
+  }
+
+  std::memcpy(&value, std::data(in), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return true;
+}
+
+[[nodiscard]] inline bool read_binary(std::string_view &in, std::string &str) {
+  std::uint64_t size;
+  if (!read_binary(in, size) || std::size(in) < size) {
+    return false;
+  }
+
+  str.assign(std::data(in), size);
+  in.remove_prefix(size);
+  return true;
+}
+
+template <typename T>
+[[nodiscard]] bool read_binary(std::string_view &in, std::vector<T> &vec) {
+  std::uint64_t size;
+  if (!read_binary(in, size)) {
+    return false;
+  }
+
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    if (std::size(in) / sizeof(T) < size) {
+      return false;
+    }
+
+    vec.resize(size);
+    std::memcpy(std::data(vec), std::data(in), size * sizeof(T));
+    in.remove_prefix(size * sizeof(T));
+  } else {
+    vec.clear();
+    for (std::uint64_t i = 0; i < size; ++i) {
+      if (!read_binary(in, vec.emplace_back())) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace kepub
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kepub_export.h"
+#include "mapped_file.h"
+#include "novel.h"
+
+namespace kepub {
+
+// Binary form of a book as written by the crawlers, read through a mapping
+// without parsing. Native byte order like binary.h:
+//
+//   Header
+//   VolumeRecord[volume_count_]
+//   ChapterRecord[chapter_count_]
+//   std::uint64_t[string_count_ + 1]   string i is [offset i, offset i + 1)
+//   UTF-8 of every string, not terminated
+//
+// Every field is 8 bytes, so the records stay aligned in the mapping
+class KEPUB_EXPORT BookFile {
+ public:
+  static constexpr std::string_view extension = ".kepub";
+
+  // Checks the layout, so the accessors can trust it
+  explicit BookFile(const std::string &file_name);
+
+  [[nodiscard]] std::string_view name() const;
+  [[nodiscard]] std::string_view author() const;
+
+  // Only copies the strings, the volumes and chapters are in file order
+  [[nodiscard]] Novel novel() const;
+
+  // Postscript is empty for the crawlers, the txt format can have one.
+  // Volumes without chapters are skipped, as by generate_txt()
+  static void write(const std::string &file_name, const BookInfo &book_info,
+                    const std::vector<Volume> &volumes,
+                    const std::vector<std::string> &postscript = {});
+
+ private:
+  // Strings [first_, first_ + count_), or records in the chapter table
+  struct Range {
+    std::uint64_t first_ = 0;
+    std::uint64_t count_ = 0;
+  };
+
+  struct Header {
+    std::array<char, 8> magic_ = {};
+    std::uint64_t volume_count_ = 0;
+    std::uint64_t chapter_count_ = 0;
+    std::uint64_t string_count_ = 0;
+
+    std::uint64_t name_ = 0;
+    std::uint64_t author_ = 0;
+    Range introduction_;
+    Range postscript_;
+  };
+
+  struct VolumeRecord {
+    std::uint64_t title_ = 0;
+    Range chapters_;
+  };
+
+  struct ChapterRecord {
+    std::uint64_t title_ = 0;
+    Range texts_;
+  };
+
+  static constexpr std::array<char, 8> magic = {'K', 'E', 'P', 'U',
+                                                'B', 'B', 'K', '1'};
+
+  [[nodiscard]] std::string_view string(std::uint64_t index) const;
+  [[nodiscard]] std::vector<std::string> strings(Range range) const;
+
+  MappedFile file_;
+  const Header *header_ = nullptr;
+  std::span<const VolumeRecord> volumes_;
+  std::span<const ChapterRecord> chapters_;
+  std::span<const std::uint64_t> offsets_;
+  const char *blob_ = nullptr;
+};
+
+}  // namespace kepub
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kepub_export.h"
+#include "novel.h"
+
+namespace kepub {
+
+// Chapters keyed by the SHA-256 of their text and compressed with zstd, so a
+// chapter that is archived again, by any book, takes no more space:
+//
+//   chapters/ab/abcd...   zstd frame of the lines, each followed by '\n'
+//   sources/01/0123...    hash of the chapter a source was normalized into
+//   books/<name>          manifest of the last version of a book
+//   images/ef/ef01....jpg bytes of an image, named by their SHA-256
+//
+// An image line of a stored chapter names the image in the store instead of
+// the numbered file of its book, so chapters of different books with the
+// same lines but other images are not mixed up
+//
+// Files are written to a temporary name and renamed, so several processes can
+// share a store
+class KEPUB_EXPORT ChapterStore {
+ public:
+  explicit ChapterStore(const std::string &path);
+
+  // Null unless KEPUB_STORE is set to a directory, created on first use
+  static ChapterStore *instance();
+
+  // Returns the hash, the chapter is only compressed if it is new
+  std::string put(const std::vector<std::string> &texts) const;
+  // Empty if the chapter is not in the store
+  [[nodiscard]] std::optional<std::vector<std::string>> get(
+      const std::string &hash) const;
+
+  // Remembers that a source normalizes into the chapter, so it does not need
+  // to be normalized again. The key must include everything that changes the
+  // result, such as a hash of the options and the source
+  void link_source(const std::string &source_key,
+                   const std::string &hash) const;
+  [[nodiscard]] std::optional<std::string> find_source(
+      const std::string &source_key) const;
+
+  // Stores every chapter and the images they refer to, which must be in the
+  // current working directory, then replaces the manifest of the book
+  void add_book(const BookInfo &book_info, const std::vector<Volume> &volumes,
+                const std::vector<std::string> &postscript = {}) const;
+  // Empty if there is no manifest for the book
+  [[nodiscard]] std::optional<Novel> load_book(const std::string &name) const;
+  // Path of an image named by an image line of a stored chapter
+  [[nodiscard]] std::string image_path(std::string_view image_name) const;
+
+ private:
+  // Same lines, with the images stored and the image lines renamed
+  [[nodiscard]] std::vector<std::string> with_stored_images(
+      const std::vector<std::string> &texts, const std::string &name) const;
+  [[nodiscard]] std::string object_path(std::string_view dir,
+                                        const std::string &hash) const;
+
+  std::string path_;
+};
+
+}  // namespace kepub
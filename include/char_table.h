@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Per code point mapping and classification used by trans_str, two indexed
+// loads for the BMP instead of hash map lookups and classifier chains
+class KEPUB_EXPORT CharTable {
+ public:
+  enum Flag : std::uint8_t {
+    // Zero-width and control characters
+    Drop = 1 << 0,
+    Whitespace = 1 << 1,
+    ChinesePunctuation = 1 << 2,
+    EnglishPunctuation = 1 << 3,
+    Cjk = 1 << 4,
+    // Where push_back() joins a line to the previous one
+    OpeningPunctuation = 1 << 5,
+    ClosingPunctuation = 1 << 6
+  };
+
+  struct Entry {
+    // 0 if the code point is kept as is
+    char16_t to_ = 0;
+    char16_t to_translation_ = 0;
+    std::uint8_t flags_ = 0;
+
+    bool operator==(const Entry &) const = default;
+  };
+
+  // from, to; both in the BMP
+  using Map = std::vector<std::pair<char32_t, char32_t>>;
+
+  // The built-in variants with chars applied on top, translation_chars are
+  // applied before them in translation mode
+  explicit CharTable(const Map &chars = {}, const Map &translation_chars = {});
+
+  // The built-in table
+  static const CharTable &instance();
+
+  void serialize(std::string &out) const;
+  // Consumes the input, empty if it is not a serialized table
+  [[nodiscard]] static std::optional<CharTable> deserialize(
+      std::string_view &in);
+
+  [[nodiscard]] Entry operator[](char32_t code_point) const {
+    if (code_point < 0x10000) [[likely]] {
+      return pages_[index_[code_point >> 8]][code_point & 0xFF];
+    }
+    return supplementary(code_point);
+  }
+
+  [[nodiscard]] bool is(char32_t code_point, Flag flag) const {
+    return (*this)[code_point].flags_ & flag;
+  }
+
+ private:
+  using Page = std::array<Entry, 256>;
+
+  struct Uninitialized {};
+  explicit CharTable(Uninitialized) {}
+
+  // Nothing is mapped outside the BMP, only the flags are computed
+  [[nodiscard]] static Entry supplementary(char32_t code_point);
+
+  std::array<std::uint16_t, 256> index_ = {};
+  // Identical pages are stored once
+  std::vector<Page> pages_;
+};
+
+}  // namespace kepub
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <oneapi/tbb/concurrent_hash_map.h>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Collects the characters that are neither CJK, punctuation, ASCII
+// alphanumerics nor spaces, and reports them all at once. Safe to use from
+// several threads
+class KEPUB_EXPORT CharValidator {
+ public:
+  CharValidator();
+
+  // Used by str_check()
+  static CharValidator &global();
+
+  // Invalid UTF-8 is an error
+  void check(std::string_view str);
+
+  [[nodiscard]] bool is_known(char32_t code_point) const;
+
+  // Unknown characters so far
+  [[nodiscard]] std::size_t size() const { return unknown_.size(); }
+
+  // Warns once with the count and first occurrence of every unknown
+  // character, in order of appearance, then starts over
+  void report();
+
+ private:
+  struct Occurrence {
+    std::uint64_t count_ = 0;
+    // Order of the first occurrence
+    std::uint64_t sequence_ = 0;
+    std::string line_;
+  };
+
+  std::bitset<0x10000> known_;
+  oneapi::tbb::concurrent_hash_map<char32_t, Occurrence> unknown_;
+  std::atomic<std::uint64_t> sequence_ = 0;
+};
+
+}  // namespace kepub
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Number of CJK characters, the same as decoding the string and counting the
+// code points with the Cjk flag, expects valid UTF-8. Most CJK characters are
+// counted from their lead byte 32 bytes at a time with AVX2
+std::int32_t KEPUB_EXPORT cjk_count(std::string_view str);
+
+}  // namespace kepub
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <oneapi/tbb/concurrent_hash_map.h>
+
+#include "kepub_export.h"
+#include "novel.h"
+#include "session.h"
+
+namespace kepub {
+
+// The parts of crawling that differ from site to site, everything else is
+// done by Crawler
+class KEPUB_EXPORT SiteAdapter {
+ public:
+  virtual ~SiteAdapter() = default;
+
+  // Loads the local credentials without sending any request, returns false if
+  // there are none
+  virtual bool load_session() { return true; }
+  // Returns false if the site requires login and the existing credentials
+  // can not be used
+  virtual bool show_user_info() { return true; }
+  // Identifies the credentials in use, such as the token, so that a login
+  // validated with other credentials is not taken as fresh. Empty for the
+  // sites whose cookies are kept by the HTTP client
+  [[nodiscard]] virtual std::string session_key() const { return {}; }
+  // Login name and password, asked for on the terminal
+  virtual std::pair<std::string, std::string> read_credentials();
+  virtual void login(const std::string &login_name,
+                     const std::string &password);
+
+  // Book information and chapter list, without downloading the cover
+  virtual std::pair<BookInfo, std::vector<Volume>> get_info(
+      const std::string &book_id) = 0;
+
+  // Called once before fetching a chapter, e.g. to pay for it
+  virtual void unlock_chapter(const Chapter &chapter);
+  // Raw response of the chapter, may be called again when it fails
+  virtual std::string fetch_chapter(const Chapter &chapter) = 0;
+  // Turns the raw response into text separated by '\n'
+  virtual std::string decode_chapter(std::string content);
+
+  virtual bool is_image(std::string_view line) const = 0;
+  // Returns nothing if the image line is invalid, the line is then dropped
+  virtual std::optional<std::string> image_url(std::string_view line) const = 0;
+  virtual std::string get_image(const std::string &url) = 0;
+  // An image named cover is saved as the book cover and is not referenced in
+  // the text
+  virtual std::string image_stem(const std::string &url);
+
+  // Numbers the images, then writes the book as txt and as a book file
+  virtual void write(BookInfo &book_info, std::vector<Volume> &volumes);
+};
+
+struct KEPUB_EXPORT CrawlOptions {
+  std::int32_t max_concurrency_ = 1;
+  std::int32_t max_retries_ = 3;
+
+  // Login validation is cached under this name, empty if the site does not
+  // require login
+  std::string session_name_;
+
+  // Whether text lines are normalized by trans_str
+  bool normalize_ = false;
+  bool translation_ = false;
+  // Selects the section of the rule file that applies to this site
+  std::string site_;
+};
+
+class KEPUB_EXPORT Crawler {
+ public:
+  Crawler(SiteAdapter &adapter, const CrawlOptions &options);
+
+  void run(const std::string &book_id);
+
+ private:
+  void login();
+  void do_login();
+  // Logs in again and calls f once more if it throws LoginExpiredError
+  template <typename F>
+  std::invoke_result_t<F> with_login(F &&f);
+  void download_cover(const BookInfo &book_info);
+
+  std::vector<std::string> get_content(const Chapter &chapter);
+  std::string fetch_chapter(const Chapter &chapter);
+  std::optional<std::string> get_image(std::string_view line);
+
+  SiteAdapter &adapter_;
+  CrawlOptions options_;
+  std::optional<Session> session_;
+  // Hash of the options, prefix of the sources hashed into their keys in the
+  // chapter store. Empty without a store
+  std::string normalize_key_;
+
+  // Requests hold it shared, logging in again holds it exclusively
+  std::shared_mutex login_mutex_;
+  std::uint64_t login_generation_ = 0;
+
+  // image url, image file name (empty if it is not referenced in the text)
+  oneapi::tbb::concurrent_hash_map<std::string, std::optional<std::string>>
+      images_;
+};
+
+}  // namespace kepub
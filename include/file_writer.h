@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Buffered output to a file with write() and writev(), without iostreams.
+// Strings larger than the buffer go out together with it in one writev()
+class KEPUB_EXPORT FileWriter {
+ public:
+  // Truncates the file
+  explicit FileWriter(const std::string &file_name);
+
+  FileWriter(const FileWriter &) = delete;
+  FileWriter &operator=(const FileWriter &) = delete;
+
+  // Without close() the buffered output is lost
+  ~FileWriter();
+
+  FileWriter &write(std::string_view str);
+  FileWriter &write(char c);
+
+  // Only written if more output follows, so that the file does not end with
+  // it
+  FileWriter &write_if_followed(char c);
+
+  // Writes out the buffer, then fsync() once
+  void close();
+
+ private:
+  static constexpr std::size_t capacity = 1 << 20;
+
+  struct Free {
+    void operator()(char *buffer) const { std::free(buffer); }
+  };
+
+  void write_pending();
+  void flush(std::string_view str = {});
+
+  std::string file_name_;
+  int fd_ = -1;
+
+  std::unique_ptr<char[], Free> buffer_;
+  std::size_t size_ = 0;
+  std::optional<char> pending_;
+};
+
+}  // namespace kepub
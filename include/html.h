@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <klib/log.h>
@@ -10,6 +15,75 @@
 
 namespace kepub {
 
+// Non-empty lines of a node, stored back to back in a single buffer, each one
+// followed by '\n'
+class KEPUB_EXPORT NodeLines {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    Iterator() = default;
+    Iterator(const NodeLines *lines, std::size_t index)
+        : lines_(lines), index_(index) {}
+
+    std::string_view operator*() const { return (*lines_)[index_]; }
+
+    Iterator &operator++() {
+      ++index_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto old = *this;
+      ++index_;
+      return old;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return index_ == other.index_;
+    }
+
+   private:
+    const NodeLines *lines_ = nullptr;
+    std::size_t index_ = 0;
+  };
+
+  [[nodiscard]] std::string_view operator[](std::size_t index) const {
+    const auto [offset, size] = lines_[index];
+    return {std::data(buffer_) + offset, size};
+  }
+
+  [[nodiscard]] Iterator begin() const { return {this, 0}; }
+  [[nodiscard]] Iterator end() const { return {this, std::size(lines_)}; }
+
+  [[nodiscard]] std::size_t size() const { return std::size(lines_); }
+  [[nodiscard]] bool empty() const { return std::empty(lines_); }
+
+  [[nodiscard]] const std::string &buffer() const { return buffer_; }
+  // Moves the buffer out, leaving the object empty
+  [[nodiscard]] std::string release_buffer() {
+    lines_.clear();
+    line_begin_ = 0;
+    return std::move(buffer_);
+  }
+
+  void append(std::string_view str) { buffer_.append(str); }
+  void line_break();
+
+ private:
+  std::string buffer_;
+  std::size_t line_begin_ = 0;
+  // offset, size
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> lines_;
+};
+
+NodeLines KEPUB_EXPORT get_node_lines(const pugi::xml_node &node,
+                                      bool is_lightnovel = false);
+
 std::vector<std::string> KEPUB_EXPORT
 get_node_texts(const pugi::xml_node &node, bool is_lightnovel = false);
 
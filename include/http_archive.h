@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+enum class HttpMode { Live, Record, Replay };
+
+struct KEPUB_EXPORT HttpArchiveOptions {
+  HttpMode mode_ = HttpMode::Live;
+  std::string path_ = "kepub_http";
+
+  // Only used when replaying, simulates the network
+  std::chrono::milliseconds latency_{0};
+  // Bytes per second, 0 means unlimited
+  std::uint64_t bandwidth_ = 0;
+};
+
+// Reads the options from KEPUB_HTTP_MODE (record or replay),
+// KEPUB_HTTP_ARCHIVE, KEPUB_HTTP_LATENCY (milliseconds) and
+// KEPUB_HTTP_BANDWIDTH (bytes per second)
+HttpArchiveOptions KEPUB_EXPORT http_archive_options_from_env();
+
+// Identifies a request, it must not contain anything that changes between
+// runs, such as a nonce or a timestamp
+std::string KEPUB_EXPORT http_key(std::string_view method,
+                                  const std::string &url,
+                                  std::string_view body = "");
+std::string KEPUB_EXPORT
+http_key(std::string_view method, const std::string &url,
+         const phmap::flat_hash_map<std::string, std::string> &data);
+
+// Records the response of each request into a directory, or answers requests
+// from it without touching the network, so that crawls can be benchmarked
+// offline
+class KEPUB_EXPORT HttpArchive {
+ public:
+  explicit HttpArchive(const HttpArchiveOptions &options);
+
+  // Configured from the environment on first use
+  static HttpArchive &instance();
+
+  [[nodiscard]] HttpMode mode() const { return options_.mode_; }
+
+  template <typename Send>
+  std::string fetch(const std::string &key, Send &&send) {
+    if (options_.mode_ == HttpMode::Replay) {
+      return replay(key);
+    }
+
+    auto response = send();
+    if (options_.mode_ == HttpMode::Record) {
+      record(key, response);
+    }
+
+    return response;
+  }
+
+  void record(const std::string &key, const std::string &response) const;
+  [[nodiscard]] std::string replay(const std::string &key) const;
+
+ private:
+  [[nodiscard]] std::string file_path(const std::string &key) const;
+
+  HttpArchiveOptions options_;
+};
+
+}  // namespace kepub
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <parallel_hashmap/phmap.h>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+struct KEPUB_EXPORT LineCacheStats {
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+
+  [[nodiscard]] double hit_ratio() const {
+    const auto total = hits_ + misses_;
+    return total == 0 ? 0 : static_cast<double>(hits_) / total;
+  }
+};
+
+// Bounded LRU cache of normalized lines. It is split into shards that are
+// locked independently, so the download threads rarely wait for each other
+class KEPUB_EXPORT LineCache {
+ public:
+  // The size of the keys and values, the bookkeeping is not counted
+  explicit LineCache(std::size_t capacity_bytes);
+
+  [[nodiscard]] std::optional<std::string> find(std::string_view key);
+  void insert(std::string_view key, const std::string &value);
+
+  [[nodiscard]] LineCacheStats stats() const;
+
+ private:
+  static constexpr std::size_t shard_count = 16;
+
+  struct Shard {
+    std::mutex mutex_;
+    // Most recently used first
+    std::list<std::pair<std::string, std::string>> entries_;
+    // The keys point into entries_
+    phmap::flat_hash_map<std::string_view, decltype(entries_)::iterator> map_;
+    std::size_t size_ = 0;
+  };
+
+  [[nodiscard]] Shard &shard_of(std::string_view key);
+
+  std::size_t shard_capacity_;
+  std::array<Shard, shard_count> shards_;
+
+  std::atomic<std::uint64_t> hits_ = 0;
+  std::atomic<std::uint64_t> misses_ = 0;
+};
+
+}  // namespace kepub
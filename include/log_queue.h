@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fmt/format.h>
+#include <oneapi/tbb/concurrent_queue.h>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+enum class LogLevel : std::uint8_t { Error, Warn, Info };
+
+// Log messages from worker threads. The arguments are copied into a queue,
+// formatting and printing happen on a single background thread. After a few
+// warnings of a kind, the rest are only counted and summarized by flush(),
+// unless they are logged by warn_each()
+class KEPUB_EXPORT LogQueue {
+ public:
+  // Warnings of a kind printed before the rest are counted
+  static constexpr std::uint64_t repeat_limit = 10;
+
+  explicit LogQueue(LogLevel level);
+
+  LogQueue(const LogQueue &) = delete;
+  LogQueue &operator=(const LogQueue &) = delete;
+
+  // Prints what is left
+  ~LogQueue();
+
+  // The level is read from KEPUB_LOG_LEVEL, "error", "warn" or "info"
+  static LogQueue &instance();
+
+  [[nodiscard]] bool enabled(LogLevel level) const { return level <= level_; }
+
+  template <typename... Args>
+  void warn(fmt::format_string<Args...> format, Args &&...args) {
+    log(LogLevel::Warn, true, format, std::forward<Args>(args)...);
+  }
+
+  // For warnings about a particular line, each one is printed
+  template <typename... Args>
+  void warn_each(fmt::format_string<Args...> format, Args &&...args) {
+    log(LogLevel::Warn, false, format, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  void info(fmt::format_string<Args...> format, Args &&...args) {
+    log(LogLevel::Info, false, format, std::forward<Args>(args)...);
+  }
+
+  // Waits until everything logged so far is printed, then summarizes the
+  // warnings that were only counted. Not for the background thread
+  void flush();
+
+  // Warnings that were counted instead of printed
+  [[nodiscard]] std::uint64_t suppressed() const {
+    return suppressed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Message {
+    LogLevel level_ = LogLevel::Info;
+    // Warnings with the same format are of the same kind
+    std::string_view format_;
+    // False for warn_each(), never counted instead of printed
+    bool limited_ = false;
+    std::function<std::string()> text_;
+    // Set by flush()
+    std::promise<void> *done_ = nullptr;
+    // Set by the destructor
+    bool stop_ = false;
+  };
+
+  // Views may not outlive the call, so strings are always copied
+  template <typename T>
+  static auto stored(T &&arg) {
+    if constexpr (std::is_convertible_v<T, std::string_view>) {
+      return std::string(std::string_view(arg));
+    } else {
+      return std::decay_t<T>(std::forward<T>(arg));
+    }
+  }
+
+  template <typename... Args>
+  void log(LogLevel level, bool limited, fmt::format_string<Args...> format,
+           Args &&...args) {
+    if (!enabled(level)) {
+      return;
+    }
+
+    const fmt::string_view format_str = format;
+    Message message;
+    message.level_ = level;
+    message.limited_ = limited;
+    message.format_ = std::string_view(format_str.data(), format_str.size());
+    message.text_ = [format_str, ... args = stored(std::forward<Args>(args))] {
+      return fmt::vformat(format_str, fmt::make_format_args(args...));
+    };
+    queue_.push(std::move(message));
+  }
+
+  void run();
+
+  LogLevel level_;
+  std::atomic<std::uint64_t> suppressed_ = 0;
+  oneapi::tbb::concurrent_bounded_queue<Message> queue_;
+  std::thread thread_;
+};
+
+}  // namespace kepub
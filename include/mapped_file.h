@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Read-only mapping of a whole file, the pages are only read when touched
+class KEPUB_EXPORT MappedFile {
+ public:
+  explicit MappedFile(const std::string &file_name);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile();
+
+  [[nodiscard]] std::string_view view() const { return {data_, size_}; }
+
+ private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+}  // namespace kepub
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "char_table.h"
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Finds lines that trans_str would only trim, so that they can be copied
+// instead of going through the transform. Runs of ASCII are checked 32 bytes
+// at a time with AVX2, other code points with a bitmap lookup. The check is
+// conservative, a line that is not clean may still come out unchanged
+class KEPUB_EXPORT Prescan {
+ public:
+  // Lines containing the first code point of a pattern are never clean
+  Prescan(const CharTable &table,
+          const std::vector<std::pair<std::string, std::string>> &rules);
+
+  // Also false for invalid UTF-8, which is left to the transform to report
+  [[nodiscard]] bool is_clean(std::string_view str) const;
+
+  void serialize(std::string &out) const;
+  // Consumes the input, empty if it is not a serialized prescan
+  [[nodiscard]] static std::optional<Prescan> deserialize(
+      std::string_view &in);
+
+ private:
+  Prescan() = default;
+
+  struct Context {
+    bool space_ = false;
+    bool punctuation_ = false;
+    char32_t code_point_ = 0;
+  };
+
+  [[nodiscard]] bool next(char32_t code_point, Context &context) const;
+
+  // Kept as is wherever they are
+  std::bitset<0x10000> plain_;
+  // Kept as is unless next to a space or repeated
+  std::bitset<0x10000> punctuation_;
+
+  // Bit (1 << (c >> 4)) of entry (c & 0xF) is set if the ASCII character c
+  // is in the set, see is_clean()
+  alignas(16) std::array<std::uint8_t, 16> ascii_allowed_ = {};
+  alignas(16) std::array<std::uint8_t, 16> ascii_punctuation_ = {};
+};
+
+}  // namespace kepub
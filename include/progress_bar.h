@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <mutex>
 #include <string>
 
 #include <indicators/progress_bar.hpp>
@@ -14,12 +17,31 @@ class KEPUB_EXPORT ProgressBar {
   explicit ProgressBar(std::size_t max_progress,
                        const std::string &postfix_text);
 
+  // Shown with the next drawing
   void set_postfix_text(const std::string &postfix_text);
+  // Counts an item, the bar is drawn at most once per update_interval
   void tick();
+  // Draws the final count, once every item is counted
+  void finish();
 
  private:
+  static constexpr std::chrono::steady_clock::duration update_interval =
+      std::chrono::milliseconds(100);
+
+  // Requires mutex_
+  void draw(std::size_t count, std::chrono::steady_clock::time_point now);
+
   indicators::ProgressBar bar_;
   std::string max_progress_str_;
+
+  std::atomic<std::size_t> count_ = 0;
+
+  // The download threads would otherwise take turns redrawing the bar
+  std::mutex mutex_;
+  std::string postfix_text_;
+  // Never goes back, a thread may get the mutex after one with a higher count
+  std::size_t shown_ = 0;
+  std::chrono::steady_clock::time_point last_update_;
 };
 
 }  // namespace kepub
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Replaces every occurrence of a set of byte patterns in one pass over the
+// input using an Aho-Corasick automaton, so the cost per line does not grow
+// with the number of rules. Matches are leftmost-longest and do not overlap,
+// which is the same as applying the rules one after another as long as no
+// replacement contains a pattern
+class KEPUB_EXPORT Replacer {
+ public:
+  // pattern, replacement; for an empty or duplicated pattern the first rule
+  // wins
+  explicit Replacer(
+      const std::vector<std::pair<std::string, std::string>> &rules);
+
+  void replace(std::string &str) const;
+
+  void serialize(std::string &out) const;
+  // Consumes the input, empty if it is not a serialized replacer
+  [[nodiscard]] static std::optional<Replacer> deserialize(
+      std::string_view &in);
+
+ private:
+  Replacer() = default;
+
+  struct State {
+    std::array<std::uint16_t, 256> next_ = {};
+    // Length of the string spelled by the path from the root
+    std::uint32_t depth_ = 0;
+    // Longest pattern that is a suffix of this state, 0 if there is none
+    std::uint32_t match_size_ = 0;
+    std::uint32_t rule_ = 0;
+  };
+
+  std::vector<std::string> replacements_;
+  std::vector<State> states_;
+};
+
+}  // namespace kepub
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "char_table.h"
+#include "kepub_export.h"
+#include "prescan.h"
+#include "replace.h"
+
+namespace kepub {
+
+// Normalization rules, one per line, '#' starts a comment:
+//
+//   char 妳 你                     maps a code point, both in the BMP
+//   phrase 赤果 赤裸                replaces a phrase after the char rules
+//   translation-char 幺 么          only with -t, before the char rules
+//   translation-phrase 颠复 颠覆    only with -t
+//
+// Rules after a "[site]" line only apply to that site, "[*]" goes back to
+// every site. Site rules take precedence over the others
+struct KEPUB_EXPORT RuleSet {
+  CharTable::Map chars_;
+  CharTable::Map translation_chars_;
+  std::vector<std::pair<std::string, std::string>> phrases_;
+  std::vector<std::pair<std::string, std::string>> translation_phrases_;
+};
+
+// Keeps the rules for every site and those for this site
+RuleSet KEPUB_EXPORT parse_rules(std::string_view text,
+                                 std::string_view site);
+
+// The built-in rules with a rule set on top, compiled into the tables used by
+// trans_str, so custom rules cost nothing more per character
+class KEPUB_EXPORT Rules {
+ public:
+  explicit Rules(const RuleSet &rule_set = {});
+
+  // Loads the compiled rules from a cache keyed by the hash of the file, the
+  // site and the version, or compiles and caches them. The cache is kept in
+  // $XDG_CACHE_HOME/kepub, or ~/.cache/kepub
+  [[nodiscard]] static Rules from_file(const std::string &file_name,
+                                       std::string_view site);
+
+  [[nodiscard]] const CharTable &table() const { return table_; }
+  [[nodiscard]] const Replacer &phrases(bool translation) const {
+    return translation ? translation_phrases_ : phrases_;
+  }
+  [[nodiscard]] const Prescan &prescan() const { return prescan_; }
+
+  void serialize(std::string &out) const;
+  // Empty if the input is not serialized rules
+  [[nodiscard]] static std::optional<Rules> deserialize(std::string_view in);
+
+ private:
+  Rules(CharTable &&table, Replacer &&phrases, Replacer &&translation_phrases,
+        Prescan &&prescan);
+
+  CharTable table_;
+  Replacer phrases_;
+  Replacer translation_phrases_;
+  Prescan prescan_;
+};
+
+// Uses the rule file named by KEPUB_RULES for the site, if any. Must be called
+// before anything is normalized
+void KEPUB_EXPORT load_rules(std::string_view site);
+
+// The rules used by trans_str. Unless load_rules() has been called, these are
+// the built-in rules plus the rules of KEPUB_RULES for every site
+KEPUB_EXPORT const Rules &rules();
+
+}  // namespace kepub
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <klib/exception.h>
+
+#include "kepub_export.h"
+
+namespace kepub {
+
+// Thrown when a site answers a request with its login expired code
+class KEPUB_EXPORT LoginExpiredError : public klib::RuntimeError {
+ public:
+  using klib::RuntimeError::RuntimeError;
+};
+
+// Remembers when the login of a site was last validated, and with which
+// credentials, so that the validation round trip can be skipped within the
+// TTL as long as the credentials are the same
+class KEPUB_EXPORT Session {
+ public:
+  // Kept in dir, $HOME if it is empty
+  Session(const std::string &name, std::chrono::seconds ttl,
+          const std::string &dir = "");
+
+  // The TTL is read from KEPUB_SESSION_TTL (seconds), 0 disables the cache
+  static std::chrono::seconds ttl_from_env();
+
+  // The key identifies the credentials, only its hash is written
+  [[nodiscard]] bool is_fresh(const std::string &key) const;
+  void validated(const std::string &key) const;
+  void invalidate() const;
+
+ private:
+  std::string path_;
+  std::chrono::seconds ttl_;
+};
+
+}  // namespace kepub
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "kepub_export.h"
+#include "line_cache.h"
 
 namespace kepub {
 
@@ -13,4 +16,29 @@ std::string KEPUB_EXPORT trans_str(std::string_view str, bool translation);
 
 std::string KEPUB_EXPORT trans_str(const char *str, bool translation);
 
+// Traditional Chinese to Simplified Chinese only, '\n' is kept as it is so a
+// whole chapter can be converted at once
+std::string KEPUB_EXPORT traditional_to_simplified(std::string_view text);
+
+struct KEPUB_EXPORT ConversionStats {
+  std::uint64_t converted_ = 0;
+  // Text without Traditional-only characters is returned as it is
+  std::uint64_t skipped_ = 0;
+};
+
+// Counts every text passed to the converter so far
+ConversionStats KEPUB_EXPORT conversion_stats();
+
+// Lines normalized so far are cached, except those that only needed trimming
+LineCacheStats KEPUB_EXPORT line_cache_stats();
+
+// trans_str without the conversion, for text that has already been through
+// traditional_to_simplified
+std::string KEPUB_EXPORT normalize_str(std::string_view str, bool translation);
+
+// Same as trans_str on every line of the block, but the conversion is done
+// once for the whole block, which should be a chapter. Empty lines are dropped
+std::vector<std::string> KEPUB_EXPORT trans_lines(std::string_view block,
+                                                  bool translation);
+
 }  // namespace kepub
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace kepub {
+
+// Decodes the code point at the beginning of a string, expects valid UTF-8
+inline char32_t decode_code_point(std::string_view str) {
+  const auto lead = static_cast<unsigned char>(str.front());
+
+  std::size_t size;
+  char32_t code_point;
+  if (lead < 0x80) {
+    return lead;
+  } else if ((lead & 0xE0) == 0xC0) {
+    size = 2;
+    code_point = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    size = 3;
+    code_point = lead & 0x0F;
+  } else {
+    size = 4;
+    code_point = lead & 0x07;
+  }
+
+  for (std::size_t i = 1; i < size && i < std::size(str); ++i) {
+    code_point =
+        (code_point << 6) | (static_cast<unsigned char>(str[i]) & 0x3F);
+  }
+
+  return code_point;
+}
+
+inline char32_t first_code_point(std::string_view str) {
+  return std::empty(str) ? 0 : decode_code_point(str);
+}
+
+inline char32_t last_code_point(std::string_view str) {
+  if (std::empty(str)) {
+    return 0;
+  }
+
+  auto begin = std::size(str) - 1;
+  while (begin > 0 &&
+         (static_cast<unsigned char>(str[begin]) & 0xC0) == 0x80) {
+    --begin;
+  }
+
+  return decode_code_point(str.substr(begin));
+}
+
+// Decodes the code point at index and advances it, returns false if the
+// sequence is not valid UTF-8 (truncated, overlong, surrogate or out of range)
+inline bool next_code_point(std::string_view str, std::size_t &index,
+                            char32_t &code_point) {
+  const auto lead = static_cast<unsigned char>(str[index]);
+  if (lead < 0x80) [[likely]] {
+    code_point = lead;
+    ++index;
+    return true;
+  }
+
+  std::size_t size;
+  char32_t min;
+  if ((lead & 0xE0) == 0xC0) {
+    size = 2;
+    min = 0x80;
+    code_point = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    size = 3;
+    min = 0x800;
+    code_point = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    size = 4;
+    min = 0x10000;
+    code_point = lead & 0x07;
+  } else {
+    return false;
+  }
+
+  if (index + size > std::size(str)) {
+    return false;
+  }
+
+  for (std::size_t i = 1; i < size; ++i) {
+    const auto byte = static_cast<unsigned char>(str[index + i]);
+    if ((byte & 0xC0) != 0x80) {
+      return false;
+    }
+    code_point = (code_point << 6) | (byte & 0x3F);
+  }
+
+  if (code_point < min || code_point > 0x10FFFF ||
+      (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+    return false;
+  }
+
+  index += size;
+  return true;
+}
+
+inline void append_code_point(std::string &str, char32_t code_point) {
+  if (code_point < 0x80) {
+    str.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    const char bytes[] = {static_cast<char>(0xC0 | (code_point >> 6)),
+                          static_cast<char>(0x80 | (code_point & 0x3F))};
+    str.append(bytes, 2);
+  } else if (code_point < 0x10000) {
+    const char bytes[] = {static_cast<char>(0xE0 | (code_point >> 12)),
+                          static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)),
+                          static_cast<char>(0x80 | (code_point & 0x3F))};
+    str.append(bytes, 3);
+  } else {
+    const char bytes[] = {static_cast<char>(0xF0 | (code_point >> 18)),
+                          static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)),
+                          static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)),
+                          static_cast<char>(0x80 | (code_point & 0x3F))};
+    str.append(bytes, 4);
+  }
+}
+
+}  // namespace kepub
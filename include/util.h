@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "kepub_export.h"
@@ -10,6 +14,81 @@
 
 namespace kepub {
 
+// Removes leading and trailing ASCII whitespace without copying
+constexpr std::string_view trim(std::string_view str) {
+  constexpr std::string_view whitespace = " \t\n\v\f\r";
+
+  const auto begin = str.find_first_not_of(whitespace);
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  const auto end = str.find_last_not_of(whitespace);
+
+  return str.substr(begin, end - begin + 1);
+}
+
+// Iterates over the lines of a buffer as trimmed views into it, empty lines are
+// skipped
+class LineRange {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    Iterator() = default;
+    explicit Iterator(std::string_view rest) : rest_(rest) { next(); }
+
+    std::string_view operator*() const { return line_; }
+
+    Iterator &operator++() {
+      next();
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto old = *this;
+      next();
+      return old;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return std::data(line_) == std::data(other.line_) &&
+             std::size(line_) == std::size(other.line_);
+    }
+
+   private:
+    void next() {
+      while (!std::empty(rest_)) {
+        const auto end = rest_.find('\n');
+        line_ = trim(rest_.substr(0, end));
+        rest_.remove_prefix(end == std::string_view::npos ? std::size(rest_)
+                                                           : end + 1);
+        if (!std::empty(line_)) {
+          return;
+        }
+      }
+      line_ = {};
+    }
+
+    std::string_view rest_;
+    std::string_view line_;
+  };
+
+  explicit LineRange(std::string_view str) : str_(str) {}
+
+  [[nodiscard]] Iterator begin() const { return Iterator(str_); }
+  [[nodiscard]] Iterator end() const { return {}; }
+
+ private:
+  std::string_view str_;
+};
+
+// The buffer must outlive the range
+inline LineRange lines(std::string_view str) { return LineRange(str); }
+
 std::string KEPUB_EXPORT footer_str();
 
 void KEPUB_EXPORT check_file_exist(const std::string &file_name);
@@ -22,23 +101,68 @@ void KEPUB_EXPORT remove_file_or_dir(const std::string &path);
 
 void KEPUB_EXPORT check_is_book_id(const std::string &book_id);
 
+// Lines of a txt file, trimmed and normalized, without the empty ones. With
+// translation, each section from a line such as "[WEB] " to the next one is
+// converted on its own, so the result of a chapter does not depend on the
+// rest of the file
 std::vector<std::string> KEPUB_EXPORT
 read_file_to_vec(const std::string &file_name, bool translation);
 
+// Writes to a temporary file unique to the process and thread, then renames
+// it, so that neither an interrupted run nor another writer of the same path
+// leaves a truncated file behind
+void KEPUB_EXPORT write_file_atomically(const std::string &path,
+                                        const std::string &data);
+
+// Unknown characters are collected in CharValidator::global() and only
+// reported by its report(), so the caller must call it once the checks are done
 void KEPUB_EXPORT str_check(const std::string &str);
 
 std::int32_t KEPUB_EXPORT str_size(const std::string &str);
 
+// Same as str_check(), str_size() and push_back() on each line, but every line
+// is decoded only once. Returns the number of CJK characters. Unknown
+// characters are only checked if check is true
+std::int32_t KEPUB_EXPORT append_lines(std::vector<std::string> &texts,
+                                       std::span<const std::string> lines,
+                                       bool connect, bool check = true);
+
+struct KEPUB_EXPORT Section {
+  std::vector<std::string> *texts_;
+  std::span<const std::string> lines_;
+};
+
+// Same as append_lines() on each section in turn, with the same result and
+// warnings, but the lines are joined in parallel
+std::int32_t KEPUB_EXPORT append_sections(std::span<const Section> sections,
+                                          bool connect, bool check = true);
+
+// Same checks and word count as append_sections() for a novel whose lines
+// are already joined, such as one read from a book file
+std::int32_t KEPUB_EXPORT check_novel(const Novel &novel, bool check = true);
+
+// An irregular format is reported at once, unknown characters only by
+// CharValidator::global().report(), as with str_check()
 void KEPUB_EXPORT volume_name_check(const std::string &volume_name);
 
+// Same as volume_name_check(), CharValidator::global().report() must be called
 void KEPUB_EXPORT title_check(const std::string &title);
 
+// Same as volume_name_check() and title_check() on each, in parallel, with
+// the irregular ones reported in a single warning
+void KEPUB_EXPORT titles_check(std::span<const std::string> volume_names,
+                               std::span<const std::string> titles);
+
 void KEPUB_EXPORT push_back(std::vector<std::string> &texts,
-                            const std::string &str, bool connect,
+                            std::string_view str, bool connect,
                             bool check = true);
 
 void KEPUB_EXPORT push_back(std::vector<std::string> &texts,
-                            const std::string &str);
+                            std::string_view str);
+
+void KEPUB_EXPORT push_back(std::vector<std::string> &texts, std::string &&str);
+
+void KEPUB_EXPORT push_back(std::vector<std::string> &texts, const char *str);
 
 std::string KEPUB_EXPORT get_login_name();
 
@@ -61,6 +185,11 @@ std::string KEPUB_EXPORT make_book_name_legal(const std::string &file_name);
 void KEPUB_EXPORT generate_txt(const BookInfo &book_info,
                                const std::vector<Chapter> &chapters);
 
+// Renames the images of the [IMAGE] lines to 001.jpg and so on, in order of
+// appearance, and updates the lines. Lines of missing images are dropped
+void KEPUB_EXPORT number_images(std::vector<Volume> &volumes);
+
+// The images should be numbered already, see number_images()
 void KEPUB_EXPORT generate_txt(const BookInfo &book_info,
                                const std::vector<Volume> &volumes);
 
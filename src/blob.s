@@ -2,8 +2,6 @@
     .global font_size
     .global style
     .global style_size
-    .global tw2s
-    .global tw2s_size
     .global TSPhrases
     .global TSPhrases_size
     .global TWVariantsRevPhrases
@@ -30,12 +28,6 @@ style_end:
 style_size:
     .int style_end - style
 
-tw2s:
-    .incbin "/usr/local/share/opencc/tw2s.json"
-tw2s_end:
-tw2s_size:
-    .int tw2s_end - tw2s
-
 TSPhrases:
     .incbin "/usr/local/share/opencc/TSPhrases.ocd2"
 TSPhrases_end:
@@ -0,0 +1,204 @@
+#include "book_file.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include <klib/log.h>
+#include <oneapi/tbb.h>
+
+#include "file_writer.h"
+
+namespace kepub {
+
+namespace {
+
+template <typename T>
+std::string_view bytes_of(const T *values, std::size_t count) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return {reinterpret_cast<const char *>(values), count * sizeof(T)};
+}
+
+}  // namespace
+
+BookFile::BookFile(const std::string &file_name) : file_(file_name) {
+  const auto data = file_.view();
+  if (std::size(data) < sizeof(Header)) {
+    klib::error("Not a book file: {}", file_name);
+  }
+
+  header_ = reinterpret_cast<const Header *>(std::data(data));
+  if (header_->magic_ != magic) {
+    klib::error("Not a book file: {}", file_name);
+  }
+
+  // Each table is checked against the size first, so the sum cannot overflow
+  const auto size = std::size(data);
+  const auto volume_count = header_->volume_count_;
+  const auto chapter_count = header_->chapter_count_;
+  const auto string_count = header_->string_count_;
+  if (volume_count > size / sizeof(VolumeRecord) ||
+      chapter_count > size / sizeof(ChapterRecord) ||
+      string_count >= size / sizeof(std::uint64_t)) {
+    klib::error("Truncated book file: {}", file_name);
+  }
+
+  const auto volumes_begin = sizeof(Header);
+  const auto chapters_begin =
+      volumes_begin + volume_count * sizeof(VolumeRecord);
+  const auto offsets_begin =
+      chapters_begin + chapter_count * sizeof(ChapterRecord);
+  const auto blob_begin =
+      offsets_begin + (string_count + 1) * sizeof(std::uint64_t);
+  if (blob_begin > size) {
+    klib::error("Truncated book file: {}", file_name);
+  }
+
+  // The mapping is page aligned and every record is a multiple of 8 bytes
+  volumes_ = {reinterpret_cast<const VolumeRecord *>(std::data(data) +
+                                                     volumes_begin),
+              volume_count};
+  chapters_ = {reinterpret_cast<const ChapterRecord *>(std::data(data) +
+                                                       chapters_begin),
+               chapter_count};
+  offsets_ = {reinterpret_cast<const std::uint64_t *>(std::data(data) +
+                                                      offsets_begin),
+              string_count + 1};
+  blob_ = std::data(data) + blob_begin;
+
+  if (!std::is_sorted(std::begin(offsets_), std::end(offsets_)) ||
+      offsets_.back() > size - blob_begin) {
+    klib::error("Invalid string table in book file: {}", file_name);
+  }
+
+  const auto in_range = [](Range range, std::uint64_t count) {
+    return range.first_ <= count && range.count_ <= count - range.first_;
+  };
+  bool valid = header_->name_ < string_count &&
+               header_->author_ < string_count &&
+               in_range(header_->introduction_, string_count) &&
+               in_range(header_->postscript_, string_count);
+  for (const auto &volume : volumes_) {
+    valid = valid && volume.title_ < string_count &&
+            in_range(volume.chapters_, chapter_count);
+  }
+  for (const auto &chapter : chapters_) {
+    valid = valid && chapter.title_ < string_count &&
+            in_range(chapter.texts_, string_count);
+  }
+  if (!valid) {
+    klib::error("Invalid record in book file: {}", file_name);
+  }
+}
+
+std::string_view BookFile::name() const { return string(header_->name_); }
+
+std::string_view BookFile::author() const { return string(header_->author_); }
+
+Novel BookFile::novel() const {
+  Novel novel;
+  novel.book_info_.name_ = name();
+  novel.book_info_.author_ = author();
+  novel.book_info_.introduction_ = strings(header_->introduction_);
+  novel.postscript_ = strings(header_->postscript_);
+
+  // Chapter record i is copied into targets[i]
+  std::vector<std::pair<Chapter *, const ChapterRecord *>> targets;
+  novel.volumes_.resize(std::size(volumes_));
+  for (std::size_t i = 0; i < std::size(volumes_); ++i) {
+    const auto &record = volumes_[i];
+    auto &volume = novel.volumes_[i];
+    volume.title_ = string(record.title_);
+    volume.chapters_.resize(record.chapters_.count_);
+
+    for (std::size_t j = 0; j < record.chapters_.count_; ++j) {
+      targets.emplace_back(&volume.chapters_[j],
+                           &chapters_[record.chapters_.first_ + j]);
+    }
+  }
+
+  oneapi::tbb::parallel_for_each(targets, [&](const auto &target) {
+    const auto &[chapter, record] = target;
+    chapter->title_ = string(record->title_);
+    chapter->texts_ = strings(record->texts_);
+  });
+
+  return novel;
+}
+
+void BookFile::write(const std::string &file_name, const BookInfo &book_info,
+                     const std::vector<Volume> &volumes,
+                     const std::vector<std::string> &postscript) {
+  std::vector<std::string_view> strings;
+  const auto add = [&](std::string_view str) {
+    strings.push_back(str);
+    return static_cast<std::uint64_t>(std::size(strings) - 1);
+  };
+  const auto add_all = [&](const std::vector<std::string> &strs) {
+    const Range range = {std::size(strings), std::size(strs)};
+    strings.insert(std::end(strings), std::begin(strs), std::end(strs));
+    return range;
+  };
+
+  Header header;
+  header.magic_ = magic;
+  header.name_ = add(book_info.name_);
+  header.author_ = add(book_info.author_);
+  header.introduction_ = add_all(book_info.introduction_);
+  header.postscript_ = add_all(postscript);
+
+  std::vector<VolumeRecord> volume_records;
+  std::vector<ChapterRecord> chapter_records;
+  for (const auto &volume : volumes) {
+    // Same as generate_txt(), so both files give the same novel
+    if (std::empty(volume.chapters_)) {
+      continue;
+    }
+
+    volume_records.push_back(
+        {add(volume.title_),
+         {std::size(chapter_records), std::size(volume.chapters_)}});
+
+    for (const auto &chapter : volume.chapters_) {
+      const auto title = add(chapter.title_);
+      chapter_records.push_back({title, add_all(chapter.texts_)});
+    }
+  }
+  header.volume_count_ = std::size(volume_records);
+  header.chapter_count_ = std::size(chapter_records);
+  header.string_count_ = std::size(strings);
+
+  std::vector<std::uint64_t> offsets;
+  offsets.reserve(std::size(strings) + 1);
+  offsets.push_back(0);
+  for (const auto str : strings) {
+    offsets.push_back(offsets.back() + std::size(str));
+  }
+
+  FileWriter writer(file_name);
+  writer.write(bytes_of(&header, 1))
+      .write(bytes_of(std::data(volume_records), std::size(volume_records)))
+      .write(bytes_of(std::data(chapter_records), std::size(chapter_records)))
+      .write(bytes_of(std::data(offsets), std::size(offsets)));
+  for (const auto str : strings) {
+    writer.write(str);
+  }
+  writer.close();
+}
+
+std::string_view BookFile::string(std::uint64_t index) const {
+  return {blob_ + offsets_[index], offsets_[index + 1] - offsets_[index]};
+}
+
+std::vector<std::string> BookFile::strings(Range range) const {
+  std::vector<std::string> result;
+  result.reserve(range.count_);
+  for (std::uint64_t i = 0; i < range.count_; ++i) {
+    result.emplace_back(string(range.first_ + i));
+  }
+
+  return result;
+}
+
+}  // namespace kepub
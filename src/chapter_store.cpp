@@ -0,0 +1,312 @@
+#include "chapter_store.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <utility>
+
+#include <klib/hash.h>
+#include <klib/log.h>
+#include <klib/util.h>
+#include <oneapi/tbb.h>
+#include <zstd.h>
+
+#include "util.h"
+
+namespace kepub {
+
+namespace {
+
+constexpr std::string_view chapter_dir = "chapters";
+constexpr std::string_view source_dir = "sources";
+constexpr std::string_view book_dir = "books";
+constexpr std::string_view image_dir = "images";
+
+// Every chapter is only compressed once, so the ratio matters more than the
+// speed
+constexpr int compression_level = 19;
+// Of a SHA-256 in hex
+constexpr std::size_t hash_size = 64;
+
+constexpr std::string_view author_prefix = "[AUTHOR] ";
+constexpr std::string_view introduction_prefix = "[INTRO] ";
+constexpr std::string_view postscript_prefix = "[POST] ";
+constexpr std::string_view volume_prefix = "[VOLUME] ";
+constexpr std::string_view chapter_prefix = "[WEB] ";
+constexpr std::string_view image_prefix = "[IMAGE] ";
+
+std::string join_lines(const std::vector<std::string> &texts) {
+  std::string text;
+  for (const auto &line : texts) {
+    text.append(line).push_back('\n');
+  }
+
+  return text;
+}
+
+std::vector<std::string> split_lines(std::string_view text) {
+  std::vector<std::string> texts;
+  while (!std::empty(text)) {
+    const auto end = text.find('\n');
+    texts.emplace_back(text.substr(0, end));
+    text.remove_prefix(end == std::string_view::npos ? std::size(text)
+                                                     : end + 1);
+  }
+
+  return texts;
+}
+
+std::string compress(std::string_view text) {
+  std::string data(ZSTD_compressBound(std::size(text)), '\0');
+  const auto size = ZSTD_compress(std::data(data), std::size(data),
+                                  std::data(text), std::size(text),
+                                  compression_level);
+  if (ZSTD_isError(size)) {
+    klib::error("ZSTD_compress() failed: {}", ZSTD_getErrorName(size));
+  }
+
+  data.resize(size);
+  return data;
+}
+
+std::optional<std::string> decompress(std::string_view data) {
+  const auto size = ZSTD_getFrameContentSize(std::data(data), std::size(data));
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return {};
+  }
+
+  std::string text(size, '\0');
+  const auto result = ZSTD_decompress(std::data(text), std::size(text),
+                                      std::data(data), std::size(data));
+  if (ZSTD_isError(result) || result != size) {
+    return {};
+  }
+
+  return text;
+}
+
+// The fan-out directories are created on demand
+void write_atomically(const std::string &path, const std::string &data) {
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path());
+  write_file_atomically(path, data);
+}
+
+}  // namespace
+
+ChapterStore::ChapterStore(const std::string &path) : path_(path) {
+  std::filesystem::create_directories(path_);
+}
+
+ChapterStore *ChapterStore::instance() {
+  static auto store = []() -> std::unique_ptr<ChapterStore> {
+    if (const auto path = klib::get_env("KEPUB_STORE"); path) {
+      klib::info("Store chapters in {}", *path);
+      return std::make_unique<ChapterStore>(*path);
+    }
+    return nullptr;
+  }();
+
+  return store.get();
+}
+
+std::string ChapterStore::put(const std::vector<std::string> &texts) const {
+  const auto text = join_lines(texts);
+  auto hash = klib::sha256_hex(text);
+
+  if (const auto path = object_path(chapter_dir, hash);
+      !std::filesystem::exists(path)) {
+    write_atomically(path, compress(text));
+  }
+
+  return hash;
+}
+
+std::optional<std::vector<std::string>> ChapterStore::get(
+    const std::string &hash) const {
+  const auto path = object_path(chapter_dir, hash);
+  if (!std::filesystem::exists(path)) {
+    return {};
+  }
+
+  const auto text = decompress(klib::read_file(path, true));
+  if (!text || klib::sha256_hex(*text) != hash) {
+    klib::warn("Ignore invalid chapter in store: {}", path);
+    return {};
+  }
+
+  return split_lines(*text);
+}
+
+void ChapterStore::link_source(const std::string &source_key,
+                               const std::string &hash) const {
+  write_atomically(object_path(source_dir, klib::sha256_hex(source_key)),
+                   hash);
+}
+
+std::optional<std::string> ChapterStore::find_source(
+    const std::string &source_key) const {
+  const auto path = object_path(source_dir, klib::sha256_hex(source_key));
+  if (!std::filesystem::exists(path)) {
+    return {};
+  }
+
+  auto hash = klib::read_file(path, false);
+  if (std::size(hash) != hash_size) {
+    klib::warn("Ignore invalid source in store: {}", path);
+    return {};
+  }
+
+  return hash;
+}
+
+void ChapterStore::add_book(const BookInfo &book_info,
+                            const std::vector<Volume> &volumes,
+                            const std::vector<std::string> &postscript) const {
+  // In the order of the manifest
+  std::vector<const std::vector<std::string> *> sections = {
+      &book_info.introduction_, &postscript};
+  for (const auto &volume : volumes) {
+    for (const auto &chapter : volume.chapters_) {
+      sections.push_back(&chapter.texts_);
+    }
+  }
+
+  std::vector<std::string> hashes(std::size(sections));
+  oneapi::tbb::parallel_for(
+      std::size_t(0), std::size(sections), [&](std::size_t i) {
+        hashes[i] = put(with_stored_images(*sections[i], book_info.name_));
+      });
+
+  std::string manifest;
+  manifest.append(author_prefix).append(book_info.author_).append("\n");
+  manifest.append(introduction_prefix).append(hashes[0]).append("\n");
+  manifest.append(postscript_prefix).append(hashes[1]).append("\n");
+
+  std::size_t i = 2;
+  for (const auto &volume : volumes) {
+    // Same as BookFile::write()
+    if (std::empty(volume.chapters_)) {
+      continue;
+    }
+
+    manifest.append(volume_prefix).append(volume.title_).append("\n");
+
+    for (const auto &chapter : volume.chapters_) {
+      manifest.append(chapter_prefix)
+          .append(hashes[i++])
+          .append(" ")
+          .append(chapter.title_)
+          .append("\n");
+    }
+  }
+
+  write_atomically(
+      (std::filesystem::path(path_) / book_dir /
+       klib::make_file_name_legal(book_info.name_))
+          .string(),
+      manifest);
+}
+
+std::optional<Novel> ChapterStore::load_book(const std::string &name) const {
+  const auto path = std::filesystem::path(path_) / book_dir /
+                    klib::make_file_name_legal(name);
+  if (!std::filesystem::exists(path)) {
+    return {};
+  }
+  const auto manifest = klib::read_file(path.string(), false);
+
+  const auto texts_of = [&](std::string_view hash) {
+    auto texts = get(std::string(hash));
+    if (!texts) {
+      klib::error("Missing chapter {} of {}", hash, name);
+    }
+    return std::move(*texts);
+  };
+
+  Novel novel;
+  novel.book_info_.name_ = name;
+
+  // Not trimmed, titles may be empty
+  std::string_view rest = manifest;
+  while (!std::empty(rest)) {
+    const auto end = rest.find('\n');
+    const auto line = rest.substr(0, end);
+    rest.remove_prefix(end == std::string_view::npos ? std::size(rest)
+                                                     : end + 1);
+
+    if (line.starts_with(author_prefix)) {
+      novel.book_info_.author_ = line.substr(std::size(author_prefix));
+    } else if (line.starts_with(introduction_prefix)) {
+      novel.book_info_.introduction_ =
+          texts_of(line.substr(std::size(introduction_prefix)));
+    } else if (line.starts_with(postscript_prefix)) {
+      novel.postscript_ = texts_of(line.substr(std::size(postscript_prefix)));
+    } else if (line.starts_with(volume_prefix)) {
+      novel.volumes_.emplace_back(
+          std::string(line.substr(std::size(volume_prefix))));
+    } else if (line.starts_with(chapter_prefix)) {
+      const auto hash_and_title = line.substr(std::size(chapter_prefix));
+      if (std::size(hash_and_title) <= hash_size) {
+        klib::error("Invalid manifest of {}: {}", name, line);
+      }
+
+      if (std::empty(novel.volumes_)) {
+        novel.volumes_.emplace_back();
+      }
+      auto &chapter = novel.volumes_.back().chapters_.emplace_back();
+      chapter.title_ = hash_and_title.substr(hash_size + 1);
+      chapter.texts_ = texts_of(hash_and_title.substr(0, hash_size));
+    } else {
+      klib::error("Invalid manifest of {}: {}", name, line);
+    }
+  }
+
+  return novel;
+}
+
+std::string ChapterStore::image_path(std::string_view image_name) const {
+  const auto stem = image_name.substr(0, image_name.find('.'));
+  if (std::size(stem) != hash_size) {
+    klib::error("Not an image in store: {}", image_name);
+  }
+
+  return object_path(image_dir, std::string(image_name));
+}
+
+std::vector<std::string> ChapterStore::with_stored_images(
+    const std::vector<std::string> &texts, const std::string &name) const {
+  auto result = texts;
+  for (auto &line : result) {
+    if (!line.starts_with(image_prefix)) [[likely]] {
+      continue;
+    }
+
+    const auto file_name = line.substr(std::size(image_prefix));
+    if (!std::filesystem::exists(file_name)) {
+      klib::error("Missing image {} of {}", file_name, name);
+    }
+
+    // Already compressed, stored as is
+    const auto data = klib::read_file(file_name, true);
+    const auto image_name =
+        klib::sha256_hex(data) +
+        std::filesystem::path(file_name).extension().string();
+    if (const auto path = object_path(image_dir, image_name);
+        !std::filesystem::exists(path)) {
+      write_atomically(path, data);
+    }
+
+    line = std::string(image_prefix) + image_name;
+  }
+
+  return result;
+}
+
+std::string ChapterStore::object_path(std::string_view dir,
+                                      const std::string &hash) const {
+  return (std::filesystem::path(path_) / dir / hash.substr(0, 2) / hash)
+      .string();
+}
+
+}  // namespace kepub
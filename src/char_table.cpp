@@ -0,0 +1,406 @@
+#include "char_table.h"
+
+#include <cstddef>
+#include <numeric>
+#include <utility>
+
+#include <klib/unicode.h>
+#include <gsl/assert>
+
+#include "binary.h"
+
+namespace kepub {
+
+namespace {
+
+constexpr std::pair<char32_t, char32_t> variants[] = {
+    {U'妳', U'你'},
+    {U'壊', U'坏'},
+    {U'拚', U'拼'},
+    {U'噁', U'恶'},
+    {U'歳', U'岁'},
+    {U'経', U'经'},
+    {U'験', U'验'},
+    {U'険', U'险'},
+    {U'撃', U'击'},
+    {U'錬', U'炼'},
+    {U'隷', U'隶'},
+    {U'毎', U'每'},
+    {U'捩', U'折'},
+    {U'殻', U'壳'},
+    {U'牠', U'它'},
+    {U'矇', U'蒙'},
+    {U'髮', U'发'},
+    {U'姊', U'姐'},
+    {U'黒', U'黑'},
+    {U'歴', U'历'},
+    {U'様', U'样'},
+    {U'甦', U'苏'},
+    {U'牴', U'抵'},
+    {U'銀', U'银'},
+    {U'齢', U'龄'},
+    {U'従', U'从'},
+    {U'酔', U'醉'},
+    {U'値', U'值'},
+    {U'発', U'发'},
+    {U'続', U'续'},
+    {U'転', U'转'},
+    {U'剣', U'剑'},
+    {U'砕', U'碎'},
+    {U'鉄', U'铁'},
+    {U'甯', U'宁'},
+    {U'鬪', U'斗'},
+    {U'寛', U'宽'},
+    {U'変', U'变'},
+    {U'鳮', U'鸡'},
+    {U'悪', U'恶'},
+    {U'霊', U'灵'},
+    {U'戦', U'战'},
+    {U'権', U'权'},
+    {U'効', U'效'},
+    {U'応', U'应'},
+    {U'覚', U'觉'},
+    {U'観', U'观'},
+    {U'気', U'气'},
+    {U'覧', U'览'},
+    {U'殭', U'僵'},
+    {U'郞', U'郎'},
+    {U'虊', U'药'},
+    {U'踼', U'踢'},
+    {U'逹', U'达'},
+    {U'鑜', U'锁'},
+    {U'髲', U'发'},
+    {U'髪', U'发'},
+    {U'実', U'实'},
+    {U'內', U'内'},
+    {U'穨', U'颓'},
+    {U'糸', U'系'},
+    {U'賍', U'赃'},
+    {U'掦', U'扬'},
+    {U'覇', U'霸'},
+    {U'姉', U'姐'},
+    {U'楽', U'乐'},
+    {U'継', U'继'},
+    {U'隠', U'隐'},
+    {U'巻', U'卷'},
+    {U'膞', U'膊'},
+    {U'髑', U'骷'},
+    {U'劄', U'札'},
+    {U'擡', U'抬'},
+    {U'⼈', U'人'},
+    {U'⾛', U'走'},
+    {U'⼤', U'大'},
+    {U'⽤', U'用'},
+    {U'⼿', U'手'},
+    {U'⼦', U'子'},
+    {U'⽽', U'而'},
+    {U'⾄', U'至'},
+    {U'⽯', U'石'},
+    {U'⼗', U'十'},
+    {U'⽩', U'白'},
+    {U'⽗', U'父'},
+    {U'⽰', U'示'},
+    {U'⾁', U'肉'},
+    {U'⼠', U'士'},
+    {U'⽌', U'止'},
+    {U'⼀', U'一'},
+    {U'⺠', U'民'},
+    {U'揹', U'背'},
+    {U'佈', U'布'},
+    {U'勐', U'猛'},
+    {U'嗳', U'哎'},
+    {U'纔', U'才'},
+    {U'繄', U'紧'},
+    {U'勧', U'劝'},
+    {U'鐡', U'铁'},
+    {U'犠', U'牺'},
+    {U'繊', U'纤'},
+    {U'郷', U'乡'},
+    {U'亊', U'事'},
+    {U'騒', U'骚'},
+    {U'聡', U'聪'},
+    {U'遅', U'迟'},
+    {U'唖', U'哑'},
+    {U'獣', U'兽'},
+    {U'読', U'读'},
+    {U'囙', U'因'},
+    {U'寘', U'置'},
+    {U'対', U'对'},
+    {U'処', U'处'},
+    {U'団', U'团'},
+    {U'祢', U'你'},
+    {U'閙', U'闹'},
+    {U'谘', U'咨'},
+    {U'摀', U'捂'},
+    {U'類', U'类'},
+    {U'諷', U'讽'},
+    {U'唿', U'呼'},
+    {U'噹', U'当'},
+    {U'沒', U'没'},
+    {U'別', U'别'},
+    {U'歿', U'殁'},
+    {U'羅', U'罗'},
+    {U'給', U'给'},
+    {U'頽', U'颓'},
+    {U'來', U'来'},
+    {U'裝', U'装'},
+    {U'燈', U'灯'},
+    {U'蓋', U'盖'},
+    {U'迴', U'回'},
+    {U'單', U'单'},
+    {U'勢', U'势'},
+    {U'結', U'结'},
+    {U'砲', U'炮'},
+    {U'採', U'采'},
+    {U'財', U'财'},
+    {U'頂', U'顶'},
+    {U'倆', U'俩'},
+    {U'祕', U'秘'},
+    {U'馀', U'余'},
+    // https://zh.wikipedia.org/wiki/%E5%85%A8%E5%BD%A2%E5%92%8C%E5%8D%8A%E5%BD%A2
+    {U'＂', U'"'},
+    {U'＃', U'#'},
+    {U'＄', U'$'},
+    {U'％', U'%'},
+    {U'＆', U'&'},
+    {U'＇', U'\''},
+    {U'＊', U'*'},
+    {U'＋', U'+'},
+    {U'．', U'.'},
+    {U'／', U'/'},
+    {U'０', U'0'},
+    {U'１', U'1'},
+    {U'２', U'2'},
+    {U'３', U'3'},
+    {U'４', U'4'},
+    {U'５', U'5'},
+    {U'６', U'6'},
+    {U'７', U'7'},
+    {U'８', U'8'},
+    {U'９', U'9'},
+    {U'＜', U'<'},
+    {U'＝', U'='},
+    {U'＞', U'>'},
+    {U'＠', U'@'},
+    {U'Ａ', U'A'},
+    {U'Ｂ', U'B'},
+    {U'Ｃ', U'C'},
+    {U'Ｄ', U'D'},
+    {U'Ｅ', U'E'},
+    {U'Ｆ', U'F'},
+    {U'Ｇ', U'G'},
+    {U'Ｈ', U'H'},
+    {U'Ｉ', U'I'},
+    {U'Ｊ', U'J'},
+    {U'Ｋ', U'K'},
+    {U'Ｌ', U'L'},
+    {U'Ｍ', U'M'},
+    {U'Ｎ', U'N'},
+    {U'Ｏ', U'O'},
+    {U'Ｐ', U'P'},
+    {U'Ｑ', U'Q'},
+    {U'Ｒ', U'R'},
+    {U'Ｓ', U'S'},
+    {U'Ｔ', U'T'},
+    {U'Ｕ', U'U'},
+    {U'Ｖ', U'V'},
+    {U'Ｗ', U'W'},
+    {U'Ｘ', U'X'},
+    {U'Ｙ', U'Y'},
+    {U'Ｚ', U'Z'},
+    {U'＼', U'\\'},
+    {U'＾', U'^'},
+    {U'｀', U'`'},
+    {U'ａ', U'a'},
+    {U'ｂ', U'b'},
+    {U'ｃ', U'c'},
+    {U'ｄ', U'd'},
+    {U'ｅ', U'e'},
+    {U'ｆ', U'f'},
+    {U'ｇ', U'g'},
+    {U'ｈ', U'h'},
+    {U'ｉ', U'i'},
+    {U'ｊ', U'j'},
+    {U'ｋ', U'k'},
+    {U'ｌ', U'l'},
+    {U'ｍ', U'm'},
+    {U'ｎ', U'n'},
+    {U'ｏ', U'o'},
+    {U'ｐ', U'p'},
+    {U'ｑ', U'q'},
+    {U'ｒ', U'r'},
+    {U'ｓ', U's'},
+    {U'ｔ', U't'},
+    {U'ｕ', U'u'},
+    {U'ｖ', U'v'},
+    {U'ｗ', U'w'},
+    {U'ｘ', U'x'},
+    {U'ｙ', U'y'},
+    {U'ｚ', U'z'},
+    {U'｛', U'{'},
+    {U'｜', U'|'},
+    {U'｝', U'}'},
+    {U'｡', U'。'},
+    {U'｢', U'「'},
+    {U'｣', U'」'},
+    {U'､', U'、'},
+    {U'･', U'·'},
+    {U'•', U'·'},
+    {U'─', U'—'},
+    {U'―', U'—'},
+    {U'∶', U'：'},
+    {U'‧', U'·'},
+    {U'・', U'·'},
+    {U'﹑', U'、'},
+    {U'〜', U'～'},
+    {U'︰', U'：'},
+};
+
+// Applied before variants in translation mode
+constexpr std::pair<char32_t, char32_t> translation_variants[] = {
+    {U'幺', U'么'}};
+
+constexpr bool fits_in_entry() {
+  for (const auto &[from, to] : variants) {
+    if (from >= 0x10000 || to >= 0x10000) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(fits_in_entry());
+
+std::uint8_t flags_of(char32_t code_point) {
+  std::uint8_t flags = 0;
+
+  if (
+      // https://en.wikipedia.org/wiki/Zero-width_space
+      code_point == U'\u200B' ||
+      // https://en.wikipedia.org/wiki/Zero-width_non-joiner
+      code_point == U'\u200C' ||
+      // https://en.wikipedia.org/wiki/Zero-width_joiner
+      code_point == U'\u200D' ||
+      // https://en.wikipedia.org/wiki/Word_joiner
+      code_point == U'\u2060' || code_point == U'\uFEFF' ||
+      klib::is_control(code_point)) {
+    flags |= CharTable::Drop;
+  }
+  if (klib::is_whitespace(code_point)) {
+    flags |= CharTable::Whitespace;
+  }
+  if (klib::is_chinese_punctuation(code_point)) {
+    flags |= CharTable::ChinesePunctuation;
+  }
+  if (klib::is_english_punctuation(code_point)) {
+    flags |= CharTable::EnglishPunctuation;
+  }
+  if (klib::is_cjk(code_point)) {
+    flags |= CharTable::Cjk;
+  }
+
+  constexpr std::u32string_view opening = U"—“「『《[【（";
+  constexpr std::u32string_view closing = U"！？，。、”」』》]】）";
+  if (opening.find(code_point) != std::u32string_view::npos) {
+    flags |= CharTable::OpeningPunctuation;
+  }
+  if (closing.find(code_point) != std::u32string_view::npos) {
+    flags |= CharTable::ClosingPunctuation;
+  }
+
+  return flags;
+}
+
+}  // namespace
+
+const CharTable &CharTable::instance() {
+  static const CharTable table;
+  return table;
+}
+
+// The klib classifiers are not constexpr, so the table is built once at
+// startup, which takes well under a millisecond
+CharTable::CharTable(const Map &chars, const Map &translation_chars) {
+  constexpr std::size_t bmp_size = 0x10000;
+
+  // The first built-in rule wins, then the later rules override
+  std::vector<char32_t> to(bmp_size);
+  std::iota(std::begin(to), std::end(to), 0);
+  for (const auto &[from, replacement] : variants) {
+    if (to[from] == from) {
+      to[from] = replacement;
+    }
+  }
+  for (const auto &[from, replacement] : chars) {
+    Expects(from < bmp_size && replacement < bmp_size);
+    to[from] = replacement;
+  }
+
+  // Applied before the other rules
+  std::vector<char32_t> translation(bmp_size);
+  std::iota(std::begin(translation), std::end(translation), 0);
+  for (const auto &[from, replacement] : translation_variants) {
+    if (translation[from] == from) {
+      translation[from] = replacement;
+    }
+  }
+  for (const auto &[from, replacement] : translation_chars) {
+    Expects(from < bmp_size && replacement < bmp_size);
+    translation[from] = replacement;
+  }
+
+  for (char32_t page_index = 0; page_index < 256; ++page_index) {
+    Page page;
+    for (char32_t offset = 0; offset < 256; ++offset) {
+      const char32_t code_point = (page_index << 8) | offset;
+      auto &entry = page[offset];
+
+      if (const auto mapped = to[code_point]; mapped != code_point) {
+        entry.to_ = static_cast<char16_t>(mapped);
+      }
+      if (const auto mapped = to[translation[code_point]];
+          mapped != code_point) {
+        entry.to_translation_ = static_cast<char16_t>(mapped);
+      }
+      entry.flags_ = flags_of(code_point);
+    }
+
+    std::size_t i = 0;
+    for (; i < std::size(pages_); ++i) {
+      if (pages_[i] == page) {
+        break;
+      }
+    }
+    if (i == std::size(pages_)) {
+      pages_.push_back(page);
+    }
+    index_[page_index] = static_cast<std::uint16_t>(i);
+  }
+}
+
+void CharTable::serialize(std::string &out) const {
+  write_binary(out, index_);
+  write_binary(out, pages_);
+}
+
+std::optional<CharTable> CharTable::deserialize(std::string_view &in) {
+  CharTable table{Uninitialized()};
+  if (!read_binary(in, table.index_) || !read_binary(in, table.pages_)) {
+    return {};
+  }
+
+  for (const auto page : table.index_) {
+    if (page >= std::size(table.pages_)) {
+      return {};
+    }
+  }
+
+  return table;
+}
+
+CharTable::Entry CharTable::supplementary(char32_t code_point) {
+  Entry entry;
+  entry.flags_ = flags_of(code_point);
+  return entry;
+}
+
+}  // namespace kepub
@@ -0,0 +1,105 @@
+#include "char_validator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <klib/log.h>
+
+#include "char_table.h"
+#include "utf8.h"
+
+namespace kepub {
+
+namespace {
+
+constexpr std::uint8_t known_flags =
+    CharTable::Cjk | CharTable::ChinesePunctuation;
+
+}  // namespace
+
+CharValidator::CharValidator() {
+  const auto &table = CharTable::instance();
+
+  for (char32_t code_point = 0; code_point < 0x10000; ++code_point) {
+    if ((table[code_point].flags_ & known_flags) ||
+        (code_point < 0x80 && std::isalnum(static_cast<int>(code_point))) ||
+        code_point == U' ' || code_point == U'◇') {
+      known_.set(code_point);
+    }
+  }
+}
+
+CharValidator &CharValidator::global() {
+  static CharValidator validator;
+  return validator;
+}
+
+void CharValidator::check(std::string_view str) {
+  // Taken once the first unknown character of the line is found
+  std::uint64_t sequence = 0;
+  bool has_sequence = false;
+
+  for (std::size_t index = 0; index < std::size(str);) {
+    char32_t code_point;
+    if (!next_code_point(str, index, code_point)) [[unlikely]] {
+      klib::error("Invalid UTF-8: {}", str);
+    }
+    if (is_known(code_point)) [[likely]] {
+      continue;
+    }
+
+    if (!has_sequence) {
+      sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+      has_sequence = true;
+    }
+
+    decltype(unknown_)::accessor accessor;
+    if (unknown_.insert(accessor, code_point)) {
+      accessor->second.sequence_ = sequence;
+      accessor->second.line_ = str;
+    } else if (sequence < accessor->second.sequence_) {
+      // Another thread got there first with a later line
+      accessor->second.sequence_ = sequence;
+      accessor->second.line_ = str;
+    }
+    ++accessor->second.count_;
+  }
+}
+
+void CharValidator::report() {
+  if (unknown_.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<char32_t, Occurrence>> occurrences(std::begin(unknown_),
+                                                           std::end(unknown_));
+  std::sort(std::begin(occurrences), std::end(occurrences),
+            [](const auto &a, const auto &b) {
+              return a.second.sequence_ < b.second.sequence_;
+            });
+
+  std::string message =
+      fmt::format("{} unknown characters:", std::size(occurrences));
+  for (const auto &[code_point, occurrence] : occurrences) {
+    std::string character;
+    append_code_point(character, code_point);
+    message.append(fmt::format("\n{} ({} times) in {}", character,
+                               occurrence.count_, occurrence.line_));
+  }
+  klib::warn("{}", message);
+
+  unknown_.clear();
+}
+
+bool CharValidator::is_known(char32_t code_point) const {
+  if (code_point < 0x10000) [[likely]] {
+    return known_[code_point];
+  }
+  return CharTable::instance()[code_point].flags_ & known_flags;
+}
+
+}  // namespace kepub
@@ -0,0 +1,75 @@
+#include "cjk_count.h"
+
+#include <bit>
+#include <cstddef>
+
+#include <immintrin.h>
+
+#include "char_table.h"
+#include "utf8.h"
+
+namespace kepub {
+
+namespace {
+
+// U+5000 to U+9FFF, all in CJK Unified Ideographs
+constexpr std::uint8_t first_cjk_lead = 0xE5;
+constexpr std::uint8_t last_cjk_lead = 0xE9;
+// Code points from U+0800, the rest can not be CJK
+constexpr std::uint8_t first_three_byte_lead = 0xE0;
+
+bool is_cjk_lead(std::uint8_t byte) {
+  return byte >= first_cjk_lead && byte <= last_cjk_lead;
+}
+
+bool is_cjk_at(std::string_view str, std::size_t index) {
+  return CharTable::instance().is(decode_code_point(str.substr(index)),
+                                  CharTable::Cjk);
+}
+
+}  // namespace
+
+std::int32_t cjk_count(std::string_view str) {
+  const auto size = std::size(str);
+  const auto data = std::data(str);
+
+  std::int32_t count = 0;
+  std::size_t index = 0;
+
+  const auto cjk_lead_offset =
+      _mm256_set1_epi8(static_cast<char>(first_cjk_lead));
+  const auto cjk_lead_range =
+      _mm256_set1_epi8(static_cast<char>(last_cjk_lead - first_cjk_lead));
+  const auto three_byte_lead =
+      _mm256_set1_epi8(static_cast<char>(first_three_byte_lead));
+  for (; index + 32 <= size; index += 32) {
+    const auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index));
+
+    // Unsigned comparisons, x <= y if min(x, y) == x
+    const auto offset = _mm256_sub_epi8(chunk, cjk_lead_offset);
+    const auto cjk = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(offset, cjk_lead_range), offset)));
+    const auto lead = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, three_byte_lead), chunk)));
+    count += std::popcount(cjk);
+
+    // Extension A, compatibility ideographs and the supplementary planes
+    for (auto rest = lead & ~cjk; rest != 0; rest &= rest - 1) {
+      count += is_cjk_at(str, index + std::countr_zero(rest));
+    }
+  }
+
+  for (; index < size; ++index) {
+    const auto byte = static_cast<std::uint8_t>(data[index]);
+    if (is_cjk_lead(byte)) {
+      ++count;
+    } else if (byte >= first_three_byte_lead) {
+      count += is_cjk_at(str, index);
+    }
+  }
+
+  return count;
+}
+
+}  // namespace kepub
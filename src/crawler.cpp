@@ -0,0 +1,345 @@
+#include "crawler.h"
+
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+
+#include <klib/exception.h>
+#include <klib/hash.h>
+#include <klib/log.h>
+#include <klib/util.h>
+#include <oneapi/tbb.h>
+
+#include "book_file.h"
+#include "chapter_store.h"
+#include "log_queue.h"
+#include "progress_bar.h"
+#include "rules.h"
+#include "trans.h"
+#include "util.h"
+#include "version.h"
+
+namespace kepub {
+
+namespace {
+
+const std::string cover_stem = "cover";
+const std::string image_prefix = "[IMAGE] ";
+
+// Hash of everything the normalized lines depend on besides the source, the
+// rule file may be large so it is only hashed once
+std::string normalize_key(const CrawlOptions &options) {
+  std::string key;
+  key.append(KEPUB_VERSION_STRING)
+      .append("\n")
+      .append(options.site_)
+      .append("\n")
+      .append(options.translation_ ? "translation" : "")
+      .append("\n");
+  if (const auto file_name = klib::get_env("KEPUB_RULES"); file_name) {
+    key.append(klib::read_file(*file_name, false));
+  }
+  key.append("\n");
+
+  return klib::sha256_hex(key);
+}
+
+}  // namespace
+
+std::pair<std::string, std::string> SiteAdapter::read_credentials() {
+  return {get_login_name(), get_password()};
+}
+
+void SiteAdapter::login(const std::string &, const std::string &) {
+  klib::error("Login is not supported");
+}
+
+void SiteAdapter::unlock_chapter(const Chapter &) {}
+
+std::string SiteAdapter::decode_chapter(std::string content) {
+  return content;
+}
+
+std::string SiteAdapter::image_stem(const std::string &url) {
+  return url_to_stem_name(url);
+}
+
+void SiteAdapter::write(BookInfo &book_info, std::vector<Volume> &volumes) {
+  number_images(volumes);
+  generate_txt(book_info, volumes);
+  // gen-epub reads it without parsing, generate_txt() already warned about
+  // the name
+  BookFile::write(klib::make_file_name_legal(book_info.name_) +
+                      std::string(BookFile::extension),
+                  book_info, volumes);
+
+  if (const auto store = ChapterStore::instance(); store) {
+    store->add_book(book_info, volumes);
+  }
+}
+
+template <typename F>
+std::invoke_result_t<F> Crawler::with_login(F &&f) {
+  std::uint64_t generation;
+  {
+    std::shared_lock lock(login_mutex_);
+    generation = login_generation_;
+    try {
+      return f();
+    } catch (const LoginExpiredError &) {
+      // Falls through to log in again once the shared lock is released
+    }
+  }
+
+  {
+    std::unique_lock lock(login_mutex_);
+    // Another request may have logged in again in the meantime
+    if (generation == login_generation_) {
+      klib::warn("Login expired, please log in again");
+      if (session_) {
+        session_->invalidate();
+      }
+      do_login();
+      ++login_generation_;
+    }
+  }
+
+  std::shared_lock lock(login_mutex_);
+  return f();
+}
+
+Crawler::Crawler(SiteAdapter &adapter, const CrawlOptions &options)
+    : adapter_(adapter), options_(options) {
+  if (!std::empty(options_.session_name_)) {
+    session_.emplace(options_.session_name_, Session::ttl_from_env());
+  }
+  if (options_.normalize_) {
+    load_rules(options_.site_);
+    if (ChapterStore::instance()) {
+      normalize_key_ = normalize_key(options_);
+    }
+  }
+}
+
+void Crawler::run(const std::string &book_id) {
+  login();
+
+  auto [book_info, volumes] =
+      with_login([&] { return adapter_.get_info(book_id); });
+  download_cover(book_info);
+
+  std::size_t chapter_count = 0;
+  for (const auto &volume : volumes) {
+    chapter_count += std::size(volume.chapters_);
+  }
+
+  klib::info("Start downloading novel content");
+  const auto stats_before = conversion_stats();
+  ProgressBar bar(chapter_count, book_info.name_);
+
+  oneapi::tbb::task_arena limited(options_.max_concurrency_);
+  oneapi::tbb::task_group task_group;
+
+  for (auto &volume : volumes) {
+    limited.execute([&] {
+      task_group.run([&] {
+        oneapi::tbb::parallel_for_each(volume.chapters_, [&](Chapter &chapter) {
+          bar.set_postfix_text(chapter.title_);
+          bar.tick();
+          chapter.texts_ = get_content(chapter);
+        });
+      });
+    });
+    limited.execute([&] { task_group.wait(); });
+  }
+  bar.finish();
+  LogQueue::instance().flush();
+
+  if (options_.normalize_ && options_.translation_) {
+    const auto stats = conversion_stats();
+    const auto skipped = stats.skipped_ - stats_before.skipped_;
+    const auto total = skipped + stats.converted_ - stats_before.converted_;
+    klib::info("{} of {} chapters are already Simplified Chinese", skipped,
+               total);
+  }
+  if (options_.normalize_) {
+    klib::info("Line cache hit ratio: {:.1f}%",
+               line_cache_stats().hit_ratio() * 100);
+  }
+
+  adapter_.write(book_info, volumes);
+  klib::info("Novel '{}' download completed", book_info.name_);
+}
+
+void Crawler::login() {
+  if (adapter_.load_session()) {
+    if (session_ && session_->is_fresh(adapter_.session_key())) {
+      klib::info("Use cached login session");
+      return;
+    }
+    if (adapter_.show_user_info()) {
+      if (session_) {
+        session_->validated(adapter_.session_key());
+      }
+      return;
+    }
+  }
+
+  do_login();
+}
+
+void Crawler::do_login() {
+  auto [login_name, password] = adapter_.read_credentials();
+  adapter_.login(login_name, password);
+  klib::cleanse(password);
+
+  if (session_) {
+    session_->validated(adapter_.session_key());
+  }
+}
+
+void Crawler::download_cover(const BookInfo &book_info) {
+  if (std::empty(book_info.cover_path_)) {
+    return;
+  }
+
+  try {
+    const auto image = adapter_.get_image(book_info.cover_path_);
+    const auto image_extension = image_to_extension(image);
+
+    if (image_extension) {
+      std::string cover_name = cover_stem + *image_extension;
+      klib::write_file(cover_name, true, image);
+      klib::info("Cover downloaded successfully: {}", cover_name);
+    } else {
+      klib::warn("Image is not a supported format: {}", book_info.cover_path_);
+    }
+  } catch (const klib::RuntimeError &err) {
+    klib::warn("{}: {}", err.what(), book_info.cover_path_);
+  }
+}
+
+std::vector<std::string> Crawler::get_content(const Chapter &chapter) {
+  with_login([&] { adapter_.unlock_chapter(chapter); });
+  const auto text = with_login(
+      [&] { return adapter_.decode_chapter(fetch_chapter(chapter)); });
+
+  // Sources normalized before with the same options are taken from the store
+  const auto store = ChapterStore::instance();
+  std::string source_key;
+  if (store && options_.normalize_) {
+    source_key = klib::sha256_hex(normalize_key_ + text);
+    if (const auto hash = store->find_source(source_key); hash) {
+      if (auto texts = store->get(*hash); texts) {
+        return std::move(*texts);
+      }
+    }
+  }
+
+  // The whole chapter is converted at once, the conversion keeps the lines so
+  // they are walked in step with the original ones, from which image lines
+  // are taken unchanged. Should it ever change the number of lines, each line
+  // is converted on its own instead
+  const bool convert = options_.normalize_ && options_.translation_;
+  const auto text_lines = lines(text);
+  std::string converted;
+  if (convert) {
+    converted = traditional_to_simplified(text);
+  }
+  const auto converted_lines = lines(converted);
+  const bool in_step =
+      convert &&
+      std::distance(std::begin(converted_lines), std::end(converted_lines)) ==
+          std::distance(std::begin(text_lines), std::end(text_lines));
+  auto converted_line = std::begin(converted_lines);
+
+  std::vector<std::string> result;
+  bool has_image = false;
+  std::string converted_alone;
+  for (const auto line : text_lines) {
+    std::string_view normalize_line = line;
+    if (convert && in_step) {
+      normalize_line = *converted_line++;
+    } else if (convert) [[unlikely]] {
+      converted_alone = traditional_to_simplified(line);
+      normalize_line = trim(converted_alone);
+    }
+
+    if (adapter_.is_image(line)) [[unlikely]] {
+      has_image = true;
+      if (auto image_name = get_image(line); image_name) {
+        push_back(result, image_prefix + *image_name);
+      }
+    } else if (options_.normalize_) {
+      // Already trimmed
+      if (auto str = normalize_str(normalize_line, options_.translation_);
+          !std::empty(str)) {
+        result.push_back(std::move(str));
+      }
+    } else {
+      push_back(result, line);
+    }
+  }
+
+  // The images are downloaded again in every run and may be named
+  // differently, so those chapters are always normalized
+  if (!std::empty(source_key) && !has_image) {
+    store->link_source(source_key, store->put(result));
+  }
+
+  return result;
+}
+
+std::string Crawler::fetch_chapter(const Chapter &chapter) {
+  for (std::int32_t retry = 1;; ++retry) {
+    try {
+      return adapter_.fetch_chapter(chapter);
+    } catch (const LoginExpiredError &) {
+      throw;
+    } catch (const klib::RuntimeError &err) {
+      if (retry >= options_.max_retries_) {
+        throw;
+      }
+      LogQueue::instance().warn("{}, retry {}/{}: {}", err.what(), retry,
+                                options_.max_retries_ - 1, chapter.title_);
+    }
+  }
+}
+
+std::optional<std::string> Crawler::get_image(std::string_view line) {
+  const auto image_url = adapter_.image_url(line);
+  if (!image_url) {
+    return {};
+  }
+
+  // The same image is only downloaded once, other chapters referring to it
+  // wait for the first download
+  decltype(images_)::accessor accessor;
+  if (!images_.insert(accessor, *image_url)) {
+    return accessor->second;
+  }
+
+  try {
+    const auto image = adapter_.get_image(*image_url);
+    const auto image_extension = image_to_extension(image);
+    if (!image_extension) {
+      LogQueue::instance().warn("Image is not a supported format: {}",
+                                *image_url);
+      return {};
+    }
+
+    const auto image_stem = adapter_.image_stem(*image_url);
+    const auto image_name = image_stem + *image_extension;
+    klib::write_file(image_name, true, image);
+
+    if (image_stem != cover_stem) {
+      accessor->second = image_name;
+    }
+  } catch (const klib::RuntimeError &err) {
+    LogQueue::instance().warn("{}: {}", err.what(), line);
+  }
+
+  return accessor->second;
+}
+
+}  // namespace kepub
@@ -0,0 +1,118 @@
+#include "file_writer.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <klib/log.h>
+
+namespace kepub {
+
+FileWriter::FileWriter(const std::string &file_name)
+    : file_name_(file_name),
+      buffer_(static_cast<char *>(std::aligned_alloc(4096, capacity))) {
+  if (!buffer_) {
+    klib::error("Failed to allocate the write buffer");
+  }
+
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0644);
+  if (fd_ == -1) {
+    klib::error("Failed to open {}: {}", file_name, std::strerror(errno));
+  }
+}
+
+FileWriter::~FileWriter() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+FileWriter &FileWriter::write(std::string_view str) {
+  write_pending();
+
+  if (std::size(str) > capacity - size_) {
+    if (std::size(str) >= capacity) {
+      flush(str);
+      return *this;
+    }
+    flush();
+  }
+
+  std::memcpy(buffer_.get() + size_, std::data(str), std::size(str));
+  size_ += std::size(str);
+  return *this;
+}
+
+FileWriter &FileWriter::write(char c) {
+  return write(std::string_view(&c, 1));
+}
+
+FileWriter &FileWriter::write_if_followed(char c) {
+  write_pending();
+  pending_ = c;
+  return *this;
+}
+
+void FileWriter::close() {
+  flush();
+
+  const auto fd = std::exchange(fd_, -1);
+  if (fsync(fd) == -1) {
+    ::close(fd);
+    klib::error("fsync() failed: {}", std::strerror(errno));
+  }
+  if (::close(fd) == -1) {
+    klib::error("Failed to close {}: {}", file_name_, std::strerror(errno));
+  }
+}
+
+void FileWriter::write_pending() {
+  if (pending_) {
+    const auto c = *pending_;
+    pending_.reset();
+    write(c);
+  }
+}
+
+void FileWriter::flush(std::string_view str) {
+  iovec iov[2] = {{buffer_.get(), size_},
+                  {const_cast<char *>(std::data(str)), std::size(str)}};
+  size_ = 0;
+
+  auto first = iov;
+  auto count = std::size(iov);
+  while (count != 0) {
+    if (first->iov_len == 0) {
+      ++first;
+      --count;
+      continue;
+    }
+
+    const auto written = writev(fd_, first, static_cast<int>(count));
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      klib::error("Failed to write {}: {}", file_name_, std::strerror(errno));
+    }
+
+    // Partial writes resume where they stopped
+    auto rest = static_cast<std::size_t>(written);
+    while (count != 0 && rest >= first->iov_len) {
+      rest -= first->iov_len;
+      ++first;
+      --count;
+    }
+    if (count != 0) {
+      first->iov_base = static_cast<char *>(first->iov_base) + rest;
+      first->iov_len -= rest;
+    }
+  }
+}
+
+}  // namespace kepub
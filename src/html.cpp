@@ -7,38 +7,138 @@ namespace kepub {
 
 namespace {
 
+enum class Tag { Other, P, Br, Div, Img, Ruby };
+
+Tag tag_of(const pugi::xml_node &node) {
+  const std::string_view name = node.name();
+
+  switch (std::size(name)) {
+    case 1:
+      return name == "p" ? Tag::P : Tag::Other;
+    case 2:
+      return name == "br" ? Tag::Br : Tag::Other;
+    case 3:
+      if (name == "div") {
+        return Tag::Div;
+      } else if (name == "img") {
+        return Tag::Img;
+      } else {
+        return Tag::Other;
+      }
+    case 4:
+      return name == "ruby" ? Tag::Ruby : Tag::Other;
+    default:
+      return Tag::Other;
+  }
+}
+
+bool is_line_break(Tag tag) {
+  return tag == Tag::P || tag == Tag::Br || tag == Tag::Div;
+}
+
 // FIXME connect: lightnovel workaround
-void do_get_node_texts(const pugi::xml_node &node, std::string &str,
-                       bool &connect) {
-  dbg(node.name());
-
-  if (node.children().begin() == node.children().end()) {
-    if (node.name() == std::string("img")) {
-      std::string image_url = node.attribute("src").as_string();
-      str += ("\n[IMAGE] " + image_url + "\n");
+bool has_ruby(const pugi::xml_node &node) {
+  auto is_ruby = [](const pugi::xml_node &n) {
+    return tag_of(n) == Tag::Ruby && !n.first_child().empty();
+  };
+
+  return is_ruby(node) || !node.find_node(is_ruby).empty();
+}
+
+class StringSink {
+ public:
+  explicit StringSink(std::string &str) : str_(str) {}
+
+  void append(std::string_view str) { str_.append(str); }
+  void line_break() { str_.push_back('\n'); }
+
+ private:
+  std::string &str_;
+};
+
+// Depth-first walk over the subtree using the parent links of pugixml, so that
+// deeply nested HTML does not grow the call stack
+template <typename Sink>
+void do_get_node_texts(const pugi::xml_node &root, Sink &sink) {
+  auto node = root;
+  auto tag = tag_of(node);
+
+  while (true) {
+    dbg(node.name());
+
+    if (auto child = node.first_child(); !child.empty()) {
+      node = child;
     } else {
-      str += node.text().as_string();
+      if (tag == Tag::Img) {
+        sink.line_break();
+        sink.append("[IMAGE] ");
+        sink.append(node.attribute("src").as_string());
+        sink.line_break();
+      } else {
+        sink.append(node.text().as_string());
+      }
+
+      while (node != root && node.next_sibling().empty()) {
+        node = node.parent();
+      }
+      if (node == root) {
+        break;
+      }
+      node = node.next_sibling();
     }
-  } else {
-    if (node.name() == std::string("ruby")) {
-      connect = true;
+
+    tag = tag_of(node);
+    if (is_line_break(tag)) {
+      sink.line_break();
     }
+  }
+}
 
-    for (const auto &child : node.children()) {
-      dbg(child.name());
+// Each top-level child starts a new line, unless it is merged into the
+// previous one by the lightnovel ruby workaround
+template <typename Sink>
+void walk_children(const pugi::xml_node &node, bool is_lightnovel,
+                   Sink &sink) {
+  std::int32_t count = 0;
+  bool first = true;
 
-      if (child.name() == std::string("p") ||
-          child.name() == std::string("br") ||
-          child.name() == std::string("div")) {
-        str += "\n";
-      }
-      do_get_node_texts(child, str, connect);
+  for (const auto &child : node.children()) {
+    if (is_lightnovel && has_ruby(child)) {
+      count = 2;
     }
+
+    if (count > 0) {
+      --count;
+    } else if (!first) {
+      sink.line_break();
+    }
+    first = false;
+
+    do_get_node_texts(child, sink);
   }
 }
 
 }  // namespace
 
+void NodeLines::line_break() {
+  const auto size = std::size(buffer_);
+  if (size == line_begin_) {
+    return;
+  }
+
+  lines_.emplace_back(line_begin_, size - line_begin_);
+  buffer_.push_back('\n');
+  line_begin_ = size + 1;
+}
+
+NodeLines get_node_lines(const pugi::xml_node &node, bool is_lightnovel) {
+  NodeLines result;
+  walk_children(node, is_lightnovel, result);
+  result.line_break();
+
+  return result;
+}
+
 std::vector<std::string> get_node_texts(const pugi::xml_node &node,
                                         bool is_lightnovel) {
   std::vector<std::string> result;
@@ -46,14 +146,7 @@ std::vector<std::string> get_node_texts(const pugi::xml_node &node,
   std::int32_t count = 0;
 
   for (const auto &child : node.children()) {
-    std::string str;
-    bool connect = false;
-    do_get_node_texts(child, str, connect);
-    if (!is_lightnovel) {
-      connect = false;
-    }
-
-    if (connect) {
+    if (is_lightnovel && has_ruby(child)) {
       count = 2;
     }
 
@@ -61,12 +154,13 @@ std::vector<std::string> get_node_texts(const pugi::xml_node &node,
       if (std::empty(result)) {
         result.emplace_back();
       }
-
-      result.back().append(str);
       --count;
     } else {
-      result.push_back(str);
+      result.emplace_back();
     }
+
+    StringSink sink(result.back());
+    do_get_node_texts(child, sink);
   }
 
   return result;
@@ -13,6 +13,8 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/json.hpp>
 
+#include "http_archive.h"
+
 namespace kepub {
 
 namespace {
@@ -26,25 +28,27 @@ void report_http_error(klib::HttpStatus status, const std::string &url) {
 }
 
 std::string http_get(const std::string &url, const std::string &proxy) {
-  request.set_browser_user_agent();
-  if (!std::empty(proxy)) {
-    request.set_proxy(proxy);
-  } else {
-    request.set_no_proxy();
-  }
-  request.set_doh_url("https://dns.google/dns-query");
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_browser_user_agent();
+    if (!std::empty(proxy)) {
+      request.set_proxy(proxy);
+    } else {
+      request.set_no_proxy();
+    }
+    request.set_doh_url("https://dns.google/dns-query");
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.get(url);
+    auto response = request.get(url);
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 std::string http_post(
@@ -52,25 +56,27 @@ std::string http_post(
     const phmap::flat_hash_map<std::string, std::string> &data,
     const phmap::flat_hash_map<std::string, std::string> &headers,
     const std::string &proxy) {
-  request.set_browser_user_agent();
-  if (!std::empty(proxy)) {
-    request.set_proxy(proxy);
-  } else {
-    request.set_no_proxy();
-  }
-  request.set_doh_url("https://dns.google/dns-query");
+  return HttpArchive::instance().fetch(http_key("POST", url, data), [&] {
+    request.set_browser_user_agent();
+    if (!std::empty(proxy)) {
+      request.set_proxy(proxy);
+    } else {
+      request.set_no_proxy();
+    }
+    request.set_doh_url("https://dns.google/dns-query");
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.post(url, data, headers);
+    auto response = request.post(url, data, headers);
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 }  // namespace
@@ -87,75 +93,82 @@ namespace lightnovel {
 
 std::string http_post(const std::string &url, const std::string &json,
                       const std::string &proxy) {
-  request.set_browser_user_agent();
-  if (!std::empty(proxy)) {
-    request.set_proxy(proxy);
-  } else {
-    request.set_no_proxy();
-  }
-  request.set_doh_url("https://dns.google/dns-query");
+  return HttpArchive::instance().fetch(http_key("POST", url, json), [&] {
+    request.set_browser_user_agent();
+    if (!std::empty(proxy)) {
+      request.set_proxy(proxy);
+    } else {
+      request.set_no_proxy();
+    }
+    request.set_doh_url("https://dns.google/dns-query");
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.post(url, json);
+    auto response = request.post(url, json);
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 std::string http_get(const std::string &url, const std::string &security_key,
                      const std::string &proxy) {
-  request.set_browser_user_agent();
-  if (!std::empty(proxy)) {
-    request.set_proxy(proxy);
-  } else {
-    request.set_no_proxy();
-  }
-
-  request.set_doh_url("https://dns.google/dns-query");
-
-  boost::json::object obj;
-  obj["security_key"] = security_key;
-  request.set_cookie({{"token", boost::json::serialize(obj)}});
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_browser_user_agent();
+    if (!std::empty(proxy)) {
+      request.set_proxy(proxy);
+    } else {
+      request.set_no_proxy();
+    }
+
+    request.set_doh_url("https://dns.google/dns-query");
+
+    boost::json::object obj;
+    obj["security_key"] = security_key;
+    request.set_cookie({{"token", boost::json::serialize(obj)}});
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.get(url);
+    auto response = request.get(url);
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 std::string http_get_rss(const std::string &url, const std::string &proxy) {
-  request.set_browser_user_agent();
-  if (!std::empty(proxy)) {
-    request.set_proxy(proxy);
-  } else {
-    request.set_no_proxy();
-  }
-  request.set_doh_url("https://dns.google/dns-query");
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_browser_user_agent();
+    if (!std::empty(proxy)) {
+      request.set_proxy(proxy);
+    } else {
+      request.set_no_proxy();
+    }
+    request.set_doh_url("https://dns.google/dns-query");
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.get(url, {{"referer", "https://www.lightnovel.us/"}});
+    auto response =
+        request.get(url, {{"referer", "https://www.lightnovel.us/"}});
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 }  // namespace lightnovel
@@ -199,70 +212,76 @@ const static std::string user_agent_geetest = "okhttp/4.8.0";
 }  // namespace
 
 std::string http_get_rss(const std::string &url) {
-  request.set_no_proxy();
-  request.set_user_agent(user_agent_rss);
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_no_proxy();
+    request.set_user_agent(user_agent_rss);
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.get(url, {{"Connection", "keep-alive"}});
+    auto response = request.get(url, {{"Connection", "keep-alive"}});
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 std::string http_get_geetest(const std::string &url) {
-  request.set_no_proxy();
-  request.set_user_agent(user_agent_geetest);
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_no_proxy();
+    request.set_user_agent(user_agent_geetest);
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  auto response = request.get(url, {{"Connection", "keep-alive"}});
+    auto response = request.get(url, {{"Connection", "keep-alive"}});
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 std::string http_post(const std::string &url,
                       phmap::flat_hash_map<std::string, std::string> data,
                       bool new_version) {
-  request.set_no_proxy();
+  return HttpArchive::instance().fetch(http_key("POST", url, data), [&] {
+    request.set_no_proxy();
 
-  if (new_version) {
-    request.set_user_agent(user_agent_new);
-  } else {
-    request.set_user_agent(user_agent);
-  }
+    if (new_version) {
+      request.set_user_agent(user_agent_new);
+    } else {
+      request.set_user_agent(user_agent);
+    }
 
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  if (new_version) {
-    data.emplace("app_version", app_version_new);
-  } else {
-    data.emplace("app_version", app_version);
-  }
+    if (new_version) {
+      data.emplace("app_version", app_version_new);
+    } else {
+      data.emplace("app_version", app_version);
+    }
 
-  data.emplace("device_token", device_token);
+    data.emplace("device_token", device_token);
 
-  auto response = request.post(url, data, {{"Connection", "keep-alive"}});
+    auto response = request.post(url, data, {{"Connection", "keep-alive"}});
 
-  auto status = response.status();
-  if (status != klib::HttpStatus::HTTP_STATUS_OK) {
-    report_http_error(status, url);
-  }
+    auto status = response.status();
+    if (status != klib::HttpStatus::HTTP_STATUS_OK) {
+      report_http_error(status, url);
+    }
 
-  return response.text();
+    return response.text();
+  });
 }
 
 }  // namespace ciweimao
@@ -293,50 +312,56 @@ std::string sf_security() {
 }  // namespace
 
 std::string http_get(const std::string &url) {
-  request.set_no_proxy();
-  request.set_user_agent(user_agent);
-  request.basic_auth(user_name, password);
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_no_proxy();
+    request.set_user_agent(user_agent);
+    request.basic_auth(user_name, password);
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  return request
-      .get(url, {{"Connection", "keep-alive"},
-                 {"Accept", "application/vnd.sfacg.api+json;version=1"},
-                 {"SFSecurity", sf_security()},
-                 {"Accept-Language", "zh-Hans-CN;q=1"}})
-      .text();
+    return request
+        .get(url, {{"Connection", "keep-alive"},
+                   {"Accept", "application/vnd.sfacg.api+json;version=1"},
+                   {"SFSecurity", sf_security()},
+                   {"Accept-Language", "zh-Hans-CN;q=1"}})
+        .text();
+  });
 }
 
 std::string http_get_rss(const std::string &url) {
-  request.set_no_proxy();
-  request.set_user_agent(user_agent_rss);
+  return HttpArchive::instance().fetch(http_key("GET", url), [&] {
+    request.set_no_proxy();
+    request.set_user_agent(user_agent_rss);
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  return request
-      .get(url, {{"Accept", "image/*,*/*;q=0.8"},
-                 {"Accept-Language", "zh-CN,zh-Hans;q=0.9"},
-                 {"Connection", "keep-alive"}})
-      .text();
+    return request
+        .get(url, {{"Accept", "image/*,*/*;q=0.8"},
+                   {"Accept-Language", "zh-CN,zh-Hans;q=0.9"},
+                   {"Connection", "keep-alive"}})
+        .text();
+  });
 }
 
 std::string http_post(const std::string &url, const std::string &json) {
-  request.set_no_proxy();
-  request.set_user_agent(user_agent);
-  request.basic_auth(user_name, password);
+  return HttpArchive::instance().fetch(http_key("POST", url, json), [&] {
+    request.set_no_proxy();
+    request.set_user_agent(user_agent);
+    request.basic_auth(user_name, password);
 #ifndef NDEBUG
-  request.verbose(true);
+    request.verbose(true);
 #endif
 
-  return request
-      .post(url, json,
-            {{"Connection", "keep-alive"},
-             {"Accept", "application/vnd.sfacg.api+json;version=1"},
-             {"SFSecurity", sf_security()},
-             {"Accept-Language", "zh-Hans-CN;q=1"}})
-      .text();
+    return request
+        .post(url, json,
+              {{"Connection", "keep-alive"},
+               {"Accept", "application/vnd.sfacg.api+json;version=1"},
+               {"SFSecurity", sf_security()},
+               {"Accept-Language", "zh-Hans-CN;q=1"}})
+        .text();
+  });
 }
 
 }  // namespace sfacg
@@ -0,0 +1,131 @@
+#include "http_archive.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <klib/hash.h>
+#include <klib/log.h>
+#include <klib/util.h>
+
+#include "util.h"
+
+namespace kepub {
+
+namespace {
+
+std::uint64_t env_to_num(const std::string &name) {
+  const auto value = klib::get_env(name);
+  if (!value) {
+    return 0;
+  }
+
+  try {
+    return std::stoull(*value);
+  } catch (const std::exception &) {
+    klib::error("Invalid value of {}: {}", name, *value);
+  }
+}
+
+}  // namespace
+
+HttpArchiveOptions http_archive_options_from_env() {
+  HttpArchiveOptions options;
+
+  if (const auto mode = klib::get_env("KEPUB_HTTP_MODE"); mode) {
+    if (*mode == "record") {
+      options.mode_ = HttpMode::Record;
+    } else if (*mode == "replay") {
+      options.mode_ = HttpMode::Replay;
+    } else if (*mode != "live") {
+      klib::error("Invalid value of KEPUB_HTTP_MODE: {}", *mode);
+    }
+  }
+
+  if (const auto path = klib::get_env("KEPUB_HTTP_ARCHIVE"); path) {
+    options.path_ = *path;
+  }
+  options.latency_ =
+      std::chrono::milliseconds(env_to_num("KEPUB_HTTP_LATENCY"));
+  options.bandwidth_ = env_to_num("KEPUB_HTTP_BANDWIDTH");
+
+  return options;
+}
+
+std::string http_key(std::string_view method, const std::string &url,
+                     std::string_view body) {
+  std::string key;
+  key.append(method).append(" ").append(url).append("\n").append(body);
+
+  return key;
+}
+
+std::string http_key(
+    std::string_view method, const std::string &url,
+    const phmap::flat_hash_map<std::string, std::string> &data) {
+  // The iteration order of the hash map is not specified
+  std::vector<std::pair<std::string, std::string>> sorted(std::begin(data),
+                                                          std::end(data));
+  std::sort(std::begin(sorted), std::end(sorted));
+
+  std::string body;
+  for (const auto &[name, value] : sorted) {
+    body.append(name).append("=").append(value).append("&");
+  }
+
+  return http_key(method, url, body);
+}
+
+HttpArchive::HttpArchive(const HttpArchiveOptions &options)
+    : options_(options) {
+  if (options_.mode_ == HttpMode::Record) {
+    std::filesystem::create_directories(options_.path_);
+    klib::info("Record HTTP responses to {}", options_.path_);
+  } else if (options_.mode_ == HttpMode::Replay) {
+    if (!std::filesystem::is_directory(options_.path_)) {
+      klib::error("HTTP archive does not exist: {}", options_.path_);
+    }
+    klib::info("Replay HTTP responses from {}", options_.path_);
+  }
+}
+
+HttpArchive &HttpArchive::instance() {
+  static HttpArchive archive(http_archive_options_from_env());
+  return archive;
+}
+
+void HttpArchive::record(const std::string &key,
+                         const std::string &response) const {
+  // Several download threads may record the same image
+  write_file_atomically(file_path(key), response);
+}
+
+std::string HttpArchive::replay(const std::string &key) const {
+  const auto path = file_path(key);
+  if (!std::filesystem::exists(path)) {
+    klib::error("No recorded response: {}", key.substr(0, key.find('\n')));
+  }
+
+  auto response = klib::read_file(path, true);
+
+  auto delay = options_.latency_;
+  if (options_.bandwidth_ != 0) {
+    delay += std::chrono::milliseconds(std::size(response) * 1000 /
+                                       options_.bandwidth_);
+  }
+  if (delay.count() > 0) {
+    std::this_thread::sleep_for(delay);
+  }
+
+  return response;
+}
+
+std::string HttpArchive::file_path(const std::string &key) const {
+  return (std::filesystem::path(options_.path_) / klib::sha256_hex(key))
+      .string();
+}
+
+}  // namespace kepub
@@ -9,6 +9,7 @@
 #include <simdjson.h>
 #include <boost/json.hpp>
 
+#include "session.h"
 #include "util.h"
 
 namespace kepub {
@@ -45,7 +46,7 @@ enum Code {
   auto doc = parser.iterate(json);                              \
   std::int32_t code = doc["code"].get_int64();                  \
   if (code == LoginExpired) {                                   \
-    klib::warn("Login expired, please log in again");           \
+    throw kepub::LoginExpiredError("Login expired");            \
   } else if (code == PasswordError) {                           \
     klib::error("Password error");                              \
   } else if (code != Ok) {                                      \
@@ -91,24 +92,23 @@ std::string http_post_serialize(const std::string &security_key) {
   return boost::json::serialize(obj);
 }
 
-UserInfo json_to_user_info(std::string json) {
+UserInfo json_to_user_info(std::string json) try {
   JSON_BASE_LIGHTNOVEL(json)
 
   UserInfo user_info;
-  user_info.login_expired_ = (code == LoginExpired);
+  user_info.nick_name_ = doc["data"]["nickname"].get_string().value();
 
-  if (!user_info.login_expired_) {
-    user_info.nick_name_ = doc["data"]["nickname"].get_string().value();
-  }
+  return user_info;
+} catch (const kepub::LoginExpiredError &) {
+  klib::warn("Login expired, please log in again");
 
+  UserInfo user_info;
+  user_info.login_expired_ = true;
   return user_info;
 }
 
-LoginInfo json_to_login_info(std::string json) {
+LoginInfo json_to_login_info(std::string json) try {
   JSON_BASE_LIGHTNOVEL(json)
-  if (code == LoginExpired) {
-    klib::error("Failed to login");
-  }
 
   LoginInfo result;
   result.security_key_ = doc["data"]["security_key"].get_string().value();
@@ -118,6 +118,8 @@ LoginInfo json_to_login_info(std::string json) {
   result.user_info_ = user_info;
 
   return result;
+} catch (const kepub::LoginExpiredError &) {
+  klib::error("Failed to login");
 }
 
 }  // namespace lightnovel
@@ -132,7 +134,7 @@ enum Code { Ok = 100000, LoginExpired = 200100 };
   auto doc = parser.iterate(json);                                      \
   auto code = std::stoi(std::string(doc["code"].get_string().value())); \
   if (code == LoginExpired) {                                           \
-    klib::warn("Login expired, please log in again");                   \
+    throw kepub::LoginExpiredError("Login expired");                    \
   } else if (code != Ok) {                                              \
     klib::error(doc["tip"].get_string().value());                       \
   }
@@ -162,17 +164,19 @@ Token json_to_token(std::string json) {
   return result;
 }
 
-UserInfo json_to_user_info(std::string json) {
+UserInfo json_to_user_info(std::string json) try {
   JSON_BASE_CIWEIMAO(json)
 
   UserInfo result;
-  result.login_expired_ = (code == LoginExpired);
+  result.nick_name_ =
+      doc["data"]["reader_info"]["reader_name"].get_string().value();
 
-  if (!result.login_expired_) {
-    result.nick_name_ =
-        doc["data"]["reader_info"]["reader_name"].get_string().value();
-  }
+  return result;
+} catch (const kepub::LoginExpiredError &) {
+  klib::warn("Login expired, please log in again");
 
+  UserInfo result;
+  result.login_expired_ = true;
   return result;
 }
 
@@ -203,11 +207,8 @@ GeetestInfo json_to_geetest_info(std::string json) {
   return info;
 }
 
-LoginInfo json_to_login_info(std::string json) {
+LoginInfo json_to_login_info(std::string json) try {
   JSON_BASE_CIWEIMAO(json)
-  if (code == LoginExpired) {
-    klib::error("Failed to login");
-  }
 
   LoginInfo result;
   auto data = doc["data"];
@@ -223,6 +224,8 @@ LoginInfo json_to_login_info(std::string json) {
   result.user_info_ = user_info;
 
   return result;
+} catch (const kepub::LoginExpiredError &) {
+  klib::error("Failed to login");
 }
 
 kepub::BookInfo json_to_book_info(std::string json) {
@@ -239,9 +242,10 @@ kepub::BookInfo json_to_book_info(std::string json) {
 
   result.cover_path_ = book_info["cover"].get_string().value();
 
-  std::string intro_str(book_info["description"].get_string().value());
+  const std::string_view intro_str =
+      book_info["description"].get_string().value();
 
-  for (const auto &line : klib::split_str(intro_str, "\n")) {
+  for (const auto line : kepub::lines(intro_str)) {
     kepub::push_back(result.introduction_, line);
   }
 
@@ -322,7 +326,7 @@ namespace sfacg {
   auto error_code =                                                       \
       static_cast<std::int32_t>(status["errorCode"].get_int64().value()); \
   if (http_code == 401 && error_code == 502) {                            \
-    klib::warn("Login expired, please log in again");                     \
+    throw kepub::LoginExpiredError("Login expired");                      \
   } else if (!(http_code == 200 && error_code == 200)) {                  \
     klib::error(status["msg"].get_string().value());                      \
   }
@@ -338,24 +342,23 @@ std::string serialize(const std::string &login_name,
 
 void json_base(std::string json){JSON_BASE_SFACG(json)}
 
-UserInfo json_to_user_info(std::string json) {
+UserInfo json_to_user_info(std::string json) try {
   JSON_BASE_SFACG(json)
 
   UserInfo result;
-  result.login_expired_ = (http_code == 401 && error_code == 502);
+  result.nick_name_ = doc["data"]["nickName"].get_string().value();
 
-  if (!result.login_expired_) {
-    result.nick_name_ = doc["data"]["nickName"].get_string().value();
-  }
+  return result;
+} catch (const kepub::LoginExpiredError &) {
+  klib::warn("Login expired, please log in again");
 
+  UserInfo result;
+  result.login_expired_ = true;
   return result;
 }
 
-LoginInfo json_to_login_info(std::string json) {
+LoginInfo json_to_login_info(std::string json) try {
   JSON_BASE_SFACG(json)
-  if (http_code == 401 && error_code == 502) {
-    klib::error("Failed to login");
-  }
 
   LoginInfo result;
   UserInfo user_info;
@@ -364,6 +367,8 @@ LoginInfo json_to_login_info(std::string json) {
   result.user_info_ = user_info;
 
   return result;
+} catch (const kepub::LoginExpiredError &) {
+  klib::error("Failed to login");
 }
 
 kepub::BookInfo json_to_book_info(std::string json) {
@@ -381,9 +386,10 @@ kepub::BookInfo json_to_book_info(std::string json) {
   result.cover_path_ = data["novelCover"].get_string().value();
   result.point_ = data["point"].get_double().value();
 
-  std::string intro_str(data["expand"]["intro"].get_string().value());
+  const std::string_view intro_str =
+      data["expand"]["intro"].get_string().value();
 
-  for (const auto &line : klib::split_str(intro_str, "\n")) {
+  for (const auto line : kepub::lines(intro_str)) {
     kepub::push_back(result.introduction_, line);
   }
 
@@ -0,0 +1,62 @@
+#include "line_cache.h"
+
+namespace kepub {
+
+LineCache::LineCache(std::size_t capacity_bytes)
+    : shard_capacity_(capacity_bytes / shard_count) {}
+
+std::optional<std::string> LineCache::find(std::string_view key) {
+  auto &shard = shard_of(key);
+
+  {
+    std::lock_guard lock(shard.mutex_);
+    if (const auto iter = shard.map_.find(key); iter != std::end(shard.map_)) {
+      shard.entries_.splice(std::begin(shard.entries_), shard.entries_,
+                            iter->second);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return iter->second->second;
+    }
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return {};
+}
+
+void LineCache::insert(std::string_view key, const std::string &value) {
+  const auto size = std::size(key) + std::size(value);
+  if (size > shard_capacity_) {
+    return;
+  }
+
+  auto &shard = shard_of(key);
+  std::lock_guard lock(shard.mutex_);
+
+  // Another thread may have computed the same line
+  if (shard.map_.contains(key)) {
+    return;
+  }
+
+  shard.entries_.emplace_front(key, value);
+  shard.map_.emplace(shard.entries_.front().first,
+                     std::begin(shard.entries_));
+  shard.size_ += size;
+
+  while (shard.size_ > shard_capacity_) {
+    const auto &[old_key, old_value] = shard.entries_.back();
+    shard.size_ -= std::size(old_key) + std::size(old_value);
+    shard.map_.erase(old_key);
+    shard.entries_.pop_back();
+  }
+}
+
+LineCacheStats LineCache::stats() const {
+  return {hits_.load(std::memory_order_relaxed),
+          misses_.load(std::memory_order_relaxed)};
+}
+
+LineCache::Shard &LineCache::shard_of(std::string_view key) {
+  // Keeps clear of the low bits, which the map stores in its control bytes
+  return shards_[(phmap::Hash<std::string_view>()(key) >> 32) % shard_count];
+}
+
+}  // namespace kepub
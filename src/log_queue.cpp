@@ -0,0 +1,101 @@
+#include "log_queue.h"
+
+#include <vector>
+
+#include <klib/log.h>
+#include <klib/util.h>
+#include <parallel_hashmap/phmap.h>
+
+namespace kepub {
+
+namespace {
+
+LogLevel level_from_env() {
+  const auto value = klib::get_env("KEPUB_LOG_LEVEL");
+  if (!value || *value == "info") {
+    return LogLevel::Info;
+  } else if (*value == "warn") {
+    return LogLevel::Warn;
+  } else if (*value == "error") {
+    return LogLevel::Error;
+  }
+
+  klib::error("Invalid value of KEPUB_LOG_LEVEL: {}", *value);
+}
+
+}  // namespace
+
+LogQueue::LogQueue(LogLevel level)
+    : level_(level), thread_([this] { run(); }) {}
+
+LogQueue::~LogQueue() {
+  Message message;
+  message.stop_ = true;
+  queue_.push(std::move(message));
+
+  thread_.join();
+}
+
+LogQueue &LogQueue::instance() {
+  static LogQueue log_queue(level_from_env());
+  return log_queue;
+}
+
+void LogQueue::flush() {
+  std::promise<void> done;
+  auto future = done.get_future();
+
+  Message message;
+  message.done_ = &done;
+  queue_.push(std::move(message));
+
+  future.wait();
+}
+
+void LogQueue::run() {
+  phmap::flat_hash_map<std::string_view, std::uint64_t> counts;
+  // In order of the first warning
+  std::vector<std::string_view> kinds;
+
+  while (true) {
+    Message message;
+    queue_.pop(message);
+
+    if (message.done_ || message.stop_) {
+      for (const auto kind : kinds) {
+        if (const auto count = counts[kind]; count > repeat_limit) {
+          klib::warn("{} more warnings like: {}", count - repeat_limit, kind);
+        }
+      }
+      counts.clear();
+      kinds.clear();
+
+      if (message.stop_) {
+        return;
+      }
+      message.done_->set_value();
+      continue;
+    }
+
+    if (message.level_ == LogLevel::Info) {
+      klib::info("{}", message.text_());
+      continue;
+    }
+    if (!message.limited_) {
+      klib::warn("{}", message.text_());
+      continue;
+    }
+
+    const auto [iter, inserted] = counts.try_emplace(message.format_, 0);
+    if (inserted) {
+      kinds.push_back(message.format_);
+    }
+    if (++iter->second <= repeat_limit) {
+      klib::warn("{}", message.text_());
+    } else {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace kepub
@@ -0,0 +1,50 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <klib/log.h>
+
+namespace kepub {
+
+MappedFile::MappedFile(const std::string &file_name) {
+  const auto fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    klib::error("Failed to open {}: {}", file_name, std::strerror(errno));
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) == -1) {
+    close(fd);
+    klib::error("fstat() failed: {}", std::strerror(errno));
+  }
+
+  // mmap() does not accept an empty mapping
+  size_ = static_cast<std::size_t>(status.st_size);
+  if (size_ != 0) {
+    auto data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      klib::error("mmap() failed: {}", std::strerror(errno));
+    }
+
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(data);
+  }
+
+  // The mapping stays valid
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+
+}  // namespace kepub
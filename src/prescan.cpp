@@ -0,0 +1,195 @@
+#include "prescan.h"
+
+#include <cstddef>
+
+#include <immintrin.h>
+
+#include "binary.h"
+#include "utf8.h"
+
+namespace kepub {
+
+namespace {
+
+// Changed by custom_trans even without context
+constexpr std::u32string_view widened = U"?!,:;()~";
+// Dropped when repeated
+constexpr std::u32string_view deduplicated = U"。，、";
+
+bool is_widened(char32_t code_point) {
+  return widened.find(code_point) != std::u32string_view::npos;
+}
+
+bool is_deduplicated(char32_t code_point) {
+  return deduplicated.find(code_point) != std::u32string_view::npos;
+}
+
+void set_ascii(std::array<std::uint8_t, 16> &table, char32_t code_point) {
+  table[code_point & 0xF] |= static_cast<std::uint8_t>(1 << (code_point >> 4));
+}
+
+// Whether each byte is in an ASCII set, the bytes must be ASCII
+__m256i ascii_in(__m256i chunk, const std::array<std::uint8_t, 16> &table) {
+  const auto by_low = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(std::data(table))));
+  const auto high_bit = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32,
+      64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const auto low_mask = _mm256_set1_epi8(0x0F);
+
+  const auto low = _mm256_and_si256(chunk, low_mask);
+  const auto high = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), low_mask);
+  const auto bits = _mm256_and_si256(_mm256_shuffle_epi8(by_low, low),
+                                     _mm256_shuffle_epi8(high_bit, high));
+
+  return _mm256_xor_si256(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256()),
+                          _mm256_set1_epi8(-1));
+}
+
+std::uint32_t to_mask(__m256i bytes) {
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(bytes));
+}
+
+}  // namespace
+
+Prescan::Prescan(
+    const CharTable &table,
+    const std::vector<std::pair<std::string, std::string>> &rules) {
+  for (char32_t code_point = 0; code_point < 0x10000; ++code_point) {
+    const auto entry = table[code_point];
+    if (entry.to_ != 0 || entry.to_translation_ != 0 ||
+        (entry.flags_ & (CharTable::Drop | CharTable::Whitespace)) ||
+        is_widened(code_point)) {
+      continue;
+    }
+
+    if (entry.flags_ & (CharTable::ChinesePunctuation |
+                        CharTable::EnglishPunctuation)) {
+      punctuation_.set(code_point);
+    } else {
+      plain_.set(code_point);
+    }
+  }
+
+  for (const auto &[pattern, replacement] : rules) {
+    if (const auto code_point = first_code_point(pattern);
+        code_point < 0x10000) {
+      plain_.reset(code_point);
+      punctuation_.reset(code_point);
+    }
+  }
+
+  for (char32_t code_point = 0; code_point < 0x80; ++code_point) {
+    if (plain_[code_point] || punctuation_[code_point] || code_point == U' ') {
+      set_ascii(ascii_allowed_, code_point);
+    }
+    if (punctuation_[code_point]) {
+      set_ascii(ascii_punctuation_, code_point);
+    }
+  }
+}
+
+bool Prescan::is_clean(std::string_view str) const {
+  constexpr std::size_t chunk_size = 32;
+
+  Context context;
+  const auto size = std::size(str);
+  for (std::size_t index = 0; index < size;) {
+    if (index + chunk_size <= size) {
+      const auto chunk = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(std::data(str) + index));
+
+      if (to_mask(chunk) == 0) {
+        if (to_mask(ascii_in(chunk, ascii_allowed_)) != 0xFFFFFFFF) {
+          return false;
+        }
+
+        const auto space =
+            to_mask(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')));
+        const auto punctuation = to_mask(ascii_in(chunk, ascii_punctuation_));
+
+        // A space is removed before punctuation, and after Chinese
+        // punctuation
+        const auto space_before = (space << 1) | context.space_;
+        const auto punctuation_before =
+            (punctuation << 1) | context.punctuation_;
+        if ((space_before & punctuation) || (punctuation_before & space)) {
+          return false;
+        }
+
+        context.space_ = space >> 31;
+        context.punctuation_ = punctuation >> 31;
+        context.code_point_ = static_cast<unsigned char>(str[index + 31]);
+        index += chunk_size;
+        continue;
+      }
+
+      // Mostly CJK, decode the code points of this chunk one by one
+      const auto end = index + chunk_size;
+      while (index < end) {
+        char32_t code_point;
+        if (!next_code_point(str, index, code_point) ||
+            !next(code_point, context)) {
+          return false;
+        }
+      }
+      continue;
+    }
+
+    char32_t code_point;
+    if (!next_code_point(str, index, code_point) ||
+        !next(code_point, context)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Prescan::serialize(std::string &out) const {
+  write_binary(out, plain_);
+  write_binary(out, punctuation_);
+  write_binary(out, ascii_allowed_);
+  write_binary(out, ascii_punctuation_);
+}
+
+std::optional<Prescan> Prescan::deserialize(std::string_view &in) {
+  Prescan prescan;
+  if (!read_binary(in, prescan.plain_) ||
+      !read_binary(in, prescan.punctuation_) ||
+      !read_binary(in, prescan.ascii_allowed_) ||
+      !read_binary(in, prescan.ascii_punctuation_)) {
+    return {};
+  }
+
+  return prescan;
+}
+
+bool Prescan::next(char32_t code_point, Context &context) const {
+  if (code_point == U' ') {
+    if (context.punctuation_) {
+      return false;
+    }
+    context.space_ = true;
+    context.punctuation_ = false;
+  } else if (code_point >= 0x10000) [[unlikely]] {
+    return false;
+  } else if (plain_[code_point]) {
+    context.space_ = false;
+    context.punctuation_ = false;
+  } else if (punctuation_[code_point]) {
+    if (context.space_ ||
+        (code_point == context.code_point_ && is_deduplicated(code_point))) {
+      return false;
+    }
+    context.space_ = false;
+    context.punctuation_ = true;
+  } else {
+    return false;
+  }
+
+  context.code_point_ = code_point;
+  return true;
+}
+
+}  // namespace kepub
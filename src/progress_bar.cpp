@@ -18,11 +18,34 @@ ProgressBar::ProgressBar(std::size_t max_progress,
       max_progress_str_(std::to_string(max_progress)) {}
 
 void ProgressBar::set_postfix_text(const std::string &postfix_text) {
-  static std::int32_t count = 1;
-  auto str = std::to_string(count++) + "/" + max_progress_str_;
-  bar_.set_option(option::PostfixText(str + " " + postfix_text));
+  std::lock_guard lock(mutex_);
+  postfix_text_ = postfix_text;
 }
 
-void ProgressBar::tick() { bar_.tick(); }
+void ProgressBar::tick() {
+  const auto count = count_.fetch_add(1, std::memory_order_relaxed) + 1;
+  const auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard lock(mutex_);
+  if (count > shown_ && now - last_update_ >= update_interval) {
+    draw(count, now);
+  }
+}
+
+void ProgressBar::finish() {
+  std::lock_guard lock(mutex_);
+  draw(count_.load(std::memory_order_relaxed),
+       std::chrono::steady_clock::now());
+}
+
+void ProgressBar::draw(std::size_t count,
+                       std::chrono::steady_clock::time_point now) {
+  shown_ = count;
+  last_update_ = now;
+
+  bar_.set_option(option::PostfixText(std::to_string(count) + "/" +
+                                      max_progress_str_ + " " + postfix_text_));
+  bar_.set_progress(count);
+}
 
 }  // namespace kepub
@@ -0,0 +1,159 @@
+#include "replace.h"
+
+#include <cstddef>
+#include <queue>
+#include <string_view>
+
+#include <gsl/assert>
+
+#include "binary.h"
+
+namespace kepub {
+
+Replacer::Replacer(
+    const std::vector<std::pair<std::string, std::string>> &rules) {
+  constexpr std::uint16_t none = 0;
+
+  // Trie, transitions to the root (0) mean there is no edge yet
+  states_.emplace_back();
+  for (const auto &[pattern, replacement] : rules) {
+    if (std::empty(pattern)) {
+      continue;
+    }
+
+    std::uint16_t state = 0;
+    for (const auto c : pattern) {
+      auto &next = states_[state].next_[static_cast<unsigned char>(c)];
+      if (next == none) {
+        Expects(std::size(states_) < 0xFFFF);
+        next = static_cast<std::uint16_t>(std::size(states_));
+
+        State child;
+        child.depth_ = states_[state].depth_ + 1;
+        states_.push_back(child);
+      }
+      state = next;
+    }
+
+    if (auto &end = states_[state]; end.match_size_ == 0) {
+      end.match_size_ = static_cast<std::uint32_t>(std::size(pattern));
+      end.rule_ = static_cast<std::uint32_t>(std::size(replacements_));
+    }
+    replacements_.push_back(replacement);
+  }
+
+  // Breadth-first, turns the trie into a DFA by following the failure links
+  std::vector<std::uint16_t> fail(std::size(states_), 0);
+  std::queue<std::uint16_t> queue;
+  for (const auto next : states_[0].next_) {
+    if (next != none) {
+      queue.push(next);
+    }
+  }
+
+  while (!std::empty(queue)) {
+    const auto state = queue.front();
+    queue.pop();
+
+    if (states_[state].match_size_ == 0) {
+      states_[state].match_size_ = states_[fail[state]].match_size_;
+      states_[state].rule_ = states_[fail[state]].rule_;
+    }
+
+    for (std::size_t c = 0; c < 256; ++c) {
+      auto &next = states_[state].next_[c];
+      const auto fail_next = states_[fail[state]].next_[c];
+
+      if (next != none) {
+        fail[next] = fail_next;
+        queue.push(next);
+      } else {
+        next = fail_next;
+      }
+    }
+  }
+}
+
+void Replacer::replace(std::string &str) const {
+  const std::string_view input = str;
+  const auto size = std::size(input);
+
+  std::string result;
+  // Input before it has been copied to result
+  std::size_t copied = 0;
+
+  constexpr auto npos = std::string_view::npos;
+  std::size_t match_begin = npos;
+  std::size_t match_end = 0;
+  std::uint32_t match_rule = 0;
+
+  std::uint16_t state = 0;
+  std::size_t index = 0;
+  while (true) {
+    if (index < size) {
+      state = states_[state].next_[static_cast<unsigned char>(input[index])];
+      ++index;
+
+      const auto &current = states_[state];
+      if (current.match_size_ != 0) [[unlikely]] {
+        const auto begin = index - current.match_size_;
+        if (match_begin == npos || begin < match_begin ||
+            (begin == match_begin && index > match_end)) {
+          match_begin = begin;
+          match_end = index;
+          match_rule = current.rule_;
+        }
+      }
+
+      // A later match can not begin at or before the pending one
+      if (match_begin == npos || index - current.depth_ <= match_begin) {
+        continue;
+      }
+    } else if (match_begin == npos) {
+      break;
+    }
+
+    result.append(input.substr(copied, match_begin - copied));
+    result.append(replacements_[match_rule]);
+    copied = match_end;
+
+    // Scan again from the end of the match without any of its context
+    index = match_end;
+    state = 0;
+    match_begin = npos;
+  }
+
+  if (copied != 0) {
+    result.append(input.substr(copied));
+    str = std::move(result);
+  }
+}
+
+void Replacer::serialize(std::string &out) const {
+  write_binary(out, replacements_);
+  write_binary(out, states_);
+}
+
+std::optional<Replacer> Replacer::deserialize(std::string_view &in) {
+  Replacer replacer;
+  if (!read_binary(in, replacer.replacements_) ||
+      !read_binary(in, replacer.states_) || std::empty(replacer.states_)) {
+    return {};
+  }
+
+  for (const auto &state : replacer.states_) {
+    for (const auto next : state.next_) {
+      if (next >= std::size(replacer.states_)) {
+        return {};
+      }
+    }
+    if (state.match_size_ != 0 &&
+        state.rule_ >= std::size(replacer.replacements_)) {
+      return {};
+    }
+  }
+
+  return replacer;
+}
+
+}  // namespace kepub
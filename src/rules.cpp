@@ -0,0 +1,279 @@
+#include "rules.h"
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+#include <klib/hash.h>
+#include <klib/log.h>
+#include <klib/util.h>
+
+#include "utf8.h"
+#include "util.h"
+#include "version.h"
+
+namespace kepub {
+
+namespace {
+
+// Bump when the serialized layout changes
+constexpr std::string_view cache_format = "2";
+
+const std::vector<std::pair<std::string, std::string>> built_in_phrases = {
+    {"赤果果", "赤裸裸"}, {"赤果", "赤裸"}, {"廿", "二十"}, {"卅", "三十"}};
+
+const std::vector<std::pair<std::string, std::string>>
+    built_in_translation_phrases = {{"颠复", "颠覆"}};
+
+std::vector<std::string_view> split_words(std::string_view line) {
+  std::vector<std::string_view> words;
+
+  constexpr std::string_view whitespace = " \t\r";
+  while (true) {
+    const auto begin = line.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos) {
+      break;
+    }
+    line.remove_prefix(begin);
+
+    const auto end = line.find_first_of(whitespace);
+    words.push_back(line.substr(0, end));
+    if (end == std::string_view::npos) {
+      break;
+    }
+    line.remove_prefix(end);
+  }
+
+  return words;
+}
+
+// A single code point in the BMP
+std::optional<char32_t> to_bmp_code_point(std::string_view word) {
+  std::size_t index = 0;
+  char32_t code_point;
+  if (!next_code_point(word, index, code_point) || index != std::size(word) ||
+      code_point >= 0x10000) {
+    return {};
+  }
+
+  return code_point;
+}
+
+template <typename T>
+void append(std::vector<T> &to, const std::vector<T> &from) {
+  to.insert(std::end(to), std::begin(from), std::end(from));
+}
+
+std::vector<std::pair<std::string, std::string>> phrase_rules(
+    const RuleSet &rule_set) {
+  auto rules = rule_set.phrases_;
+  append(rules, built_in_phrases);
+  return rules;
+}
+
+std::vector<std::pair<std::string, std::string>> translation_phrase_rules(
+    const RuleSet &rule_set) {
+  auto rules = rule_set.translation_phrases_;
+  append(rules, built_in_translation_phrases);
+  append(rules, phrase_rules(rule_set));
+  return rules;
+}
+
+// Per user, so that processes of other users neither see nor replace it
+std::filesystem::path cache_dir() {
+  if (const auto dir = klib::get_env("XDG_CACHE_HOME");
+      dir && !std::empty(*dir)) {
+    return std::filesystem::path(*dir) / "kepub";
+  }
+  if (const auto home = klib::get_env("HOME"); home && !std::empty(*home)) {
+    return std::filesystem::path(*home) / ".cache" / "kepub";
+  }
+
+  return std::filesystem::temp_directory_path() /
+         ("kepub_" + std::to_string(getuid()));
+}
+
+std::unique_ptr<const Rules> &loaded_rules() {
+  static std::unique_ptr<const Rules> rules;
+  return rules;
+}
+
+Rules rules_from_env(std::string_view site) {
+  if (const auto file_name = klib::get_env("KEPUB_RULES"); file_name) {
+    klib::info("Use normalization rules from {}", *file_name);
+    return Rules::from_file(*file_name, site);
+  }
+
+  return Rules();
+}
+
+}  // namespace
+
+RuleSet parse_rules(std::string_view text, std::string_view site) {
+  RuleSet global;
+  RuleSet site_only;
+  // Null if the current section is for another site
+  RuleSet *current = &global;
+
+  std::size_t line_number = 0;
+  while (!std::empty(text)) {
+    const auto end = text.find('\n');
+    auto line = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? std::size(text)
+                                                     : end + 1);
+    ++line_number;
+
+    if (const auto comment = line.find('#');
+        comment != std::string_view::npos) {
+      line = line.substr(0, comment);
+    }
+    const auto words = split_words(line);
+    if (std::empty(words)) {
+      continue;
+    }
+
+    const auto first = words.front();
+    if (std::size(words) == 1 && first.starts_with('[') &&
+        first.ends_with(']')) {
+      const auto name = first.substr(1, std::size(first) - 2);
+      if (name == "*") {
+        current = &global;
+      } else if (name == site) {
+        current = &site_only;
+      } else {
+        current = nullptr;
+      }
+      continue;
+    }
+
+    if (std::size(words) != 3) {
+      klib::error("Invalid rule at line {}: {}", line_number, line);
+    }
+    if (!current) {
+      continue;
+    }
+
+    const auto from = std::string(words[1]);
+    const auto to = std::string(words[2]);
+    if (first == "char" || first == "translation-char") {
+      const auto from_code_point = to_bmp_code_point(from);
+      const auto to_code_point = to_bmp_code_point(to);
+      if (!from_code_point || !to_code_point) {
+        klib::error(
+            "A char rule maps one code point in the BMP to another, line {}: "
+            "{}",
+            line_number, line);
+      }
+
+      auto &map =
+          first == "char" ? current->chars_ : current->translation_chars_;
+      map.emplace_back(*from_code_point, *to_code_point);
+    } else if (first == "phrase") {
+      current->phrases_.emplace_back(from, to);
+    } else if (first == "translation-phrase") {
+      current->translation_phrases_.emplace_back(from, to);
+    } else {
+      klib::error("Unknown rule at line {}: {}", line_number, line);
+    }
+  }
+
+  // Later char rules override earlier ones, while the first phrase rule for a
+  // pattern wins
+  append(global.chars_, site_only.chars_);
+  append(global.translation_chars_, site_only.translation_chars_);
+  append(site_only.phrases_, global.phrases_);
+  append(site_only.translation_phrases_, global.translation_phrases_);
+  global.phrases_ = std::move(site_only.phrases_);
+  global.translation_phrases_ = std::move(site_only.translation_phrases_);
+
+  return global;
+}
+
+Rules::Rules(const RuleSet &rule_set)
+    : table_(rule_set.chars_, rule_set.translation_chars_),
+      phrases_(phrase_rules(rule_set)),
+      translation_phrases_(translation_phrase_rules(rule_set)),
+      // Built from the larger rule set, so it works for both modes
+      prescan_(table_, translation_phrase_rules(rule_set)) {}
+
+Rules::Rules(CharTable &&table, Replacer &&phrases,
+             Replacer &&translation_phrases, Prescan &&prescan)
+    : table_(std::move(table)),
+      phrases_(std::move(phrases)),
+      translation_phrases_(std::move(translation_phrases)),
+      prescan_(std::move(prescan)) {}
+
+Rules Rules::from_file(const std::string &file_name, std::string_view site) {
+  if (!std::filesystem::is_regular_file(file_name)) {
+    klib::error("Rule file does not exist: {}", file_name);
+  }
+  const auto text = klib::read_file(file_name, false);
+
+  std::string key;
+  key.append(KEPUB_VERSION_STRING)
+      .append("\n")
+      .append(cache_format)
+      .append("\n")
+      .append(site)
+      .append("\n")
+      .append(text);
+  const auto dir = cache_dir();
+  const auto cache_path = (dir / ("rules_" + klib::sha256_hex(key))).string();
+
+  if (std::filesystem::exists(cache_path)) {
+    if (auto rules = deserialize(klib::read_file(cache_path, true)); rules) {
+      return std::move(*rules);
+    }
+    klib::warn("Ignore invalid rule cache: {}", cache_path);
+  }
+
+  Rules rules(parse_rules(text, site));
+
+  std::string data;
+  rules.serialize(data);
+  // Other processes may be writing the same cache
+  std::filesystem::create_directories(dir);
+  write_file_atomically(cache_path, data);
+
+  return rules;
+}
+
+void Rules::serialize(std::string &out) const {
+  table_.serialize(out);
+  phrases_.serialize(out);
+  translation_phrases_.serialize(out);
+  prescan_.serialize(out);
+}
+
+std::optional<Rules> Rules::deserialize(std::string_view in) {
+  auto table = CharTable::deserialize(in);
+  auto phrases = Replacer::deserialize(in);
+  auto translation_phrases = Replacer::deserialize(in);
+  auto prescan = Prescan::deserialize(in);
+  if (!table || !phrases || !translation_phrases || !prescan ||
+      !std::empty(in)) {
+    return {};
+  }
+
+  return Rules(std::move(*table), std::move(*phrases),
+               std::move(*translation_phrases), std::move(*prescan));
+}
+
+void load_rules(std::string_view site) {
+  if (klib::get_env("KEPUB_RULES")) {
+    loaded_rules() = std::make_unique<const Rules>(rules_from_env(site));
+  }
+}
+
+const Rules &rules() {
+  if (const auto &loaded = loaded_rules(); loaded) {
+    return *loaded;
+  }
+
+  static const auto rules = rules_from_env("");
+  return rules;
+}
+
+}  // namespace kepub
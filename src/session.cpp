@@ -0,0 +1,81 @@
+#include "session.h"
+
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+
+#include <klib/hash.h>
+#include <klib/log.h>
+#include <klib/util.h>
+
+namespace kepub {
+
+namespace {
+
+constexpr std::chrono::seconds default_ttl = std::chrono::hours(1);
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+Session::Session(const std::string &name, std::chrono::seconds ttl,
+                 const std::string &dir)
+    : path_((std::empty(dir) ? klib::get_env("HOME").value_or("/tmp") : dir) +
+            "/.kepub_session_" + name),
+      ttl_(ttl) {}
+
+std::chrono::seconds Session::ttl_from_env() {
+  const auto value = klib::get_env("KEPUB_SESSION_TTL");
+  if (!value) {
+    return default_ttl;
+  }
+
+  try {
+    return std::chrono::seconds(std::stoll(*value));
+  } catch (const std::exception &) {
+    klib::error("Invalid value of KEPUB_SESSION_TTL: {}", *value);
+  }
+}
+
+bool Session::is_fresh(const std::string &key) const {
+  if (ttl_.count() <= 0 || !std::filesystem::exists(path_)) {
+    return false;
+  }
+
+  // The time of the validation, then the hash of the key
+  const auto content = klib::read_file(path_, false);
+  const auto newline = content.find('\n');
+  if (newline == std::string::npos ||
+      content.substr(newline + 1) != klib::sha256_hex(key)) {
+    klib::info("The credentials have changed since the last validation");
+    invalidate();
+    return false;
+  }
+
+  std::int64_t validated_time;
+  try {
+    validated_time = std::stoll(content.substr(0, newline));
+  } catch (const std::exception &) {
+    return false;
+  }
+
+  const auto elapsed = now() - validated_time;
+  return elapsed >= 0 && elapsed < ttl_.count();
+}
+
+void Session::validated(const std::string &key) const {
+  if (ttl_.count() > 0) {
+    klib::write_file(path_, false,
+                     std::to_string(now()) + "\n" + klib::sha256_hex(key));
+  }
+}
+
+void Session::invalidate() const {
+  std::filesystem::remove(path_);
+}
+
+}  // namespace kepub
@@ -3,45 +3,220 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <sstream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 #include <klib/log.h>
 #include <klib/mime.h>
 #include <klib/qr_code.h>
-#include <klib/unicode.h>
 #include <klib/url.h>
 #include <klib/util.h>
 #include <oneapi/tbb.h>
 #include <parallel_hashmap/phmap.h>
 #include <re2/re2.h>
+#include <re2/set.h>
 #include <gsl/assert>
 
+#include "char_table.h"
+#include "char_validator.h"
+#include "cjk_count.h"
+#include "file_writer.h"
+#include "log_queue.h"
+#include "mapped_file.h"
 #include "trans.h"
+#include "utf8.h"
 
 namespace kepub {
 
 namespace {
 
-bool start_with_chinese(const std::string &str) {
-  return klib::is_cjk(klib::first_code_point(str));
+// Lines of the txt format that begin a new section, see generate_txt()
+constexpr std::string_view section_prefixes[] = {
+    "[AUTHOR]", "[INTRO]", "[POST]", "[VOLUME] ", "[WEB] "};
+
+bool is_section_start(std::string_view line) {
+  return std::any_of(
+      std::begin(section_prefixes), std::end(section_prefixes),
+      [&](std::string_view prefix) { return line.starts_with(prefix); });
+}
+
+// Same as trans_lines() on each section of the block in turn
+std::vector<std::string> trans_sections(std::string_view block,
+                                        bool translation) {
+  if (!translation) {
+    return trans_lines(block, translation);
+  }
+
+  std::vector<std::string> result;
+  while (!std::empty(block)) {
+    // The first line of the block begins its section
+    auto end = block.find('\n');
+    while (end != std::string_view::npos &&
+           !is_section_start(block.substr(end + 1))) {
+      end = block.find('\n', end + 1);
+    }
+    end = end == std::string_view::npos ? std::size(block) : end + 1;
+
+    auto lines = trans_lines(block.substr(0, end), translation);
+    result.insert(std::end(result), std::make_move_iterator(std::begin(lines)),
+                  std::make_move_iterator(std::end(lines)));
+    block.remove_prefix(end);
+  }
+
+  return result;
+}
+
+bool is_ascii_alpha(char32_t code_point) {
+  return code_point < 0x80 && std::isalpha(static_cast<int>(code_point));
+}
+
+bool is_ascii_alnum(char32_t code_point) {
+  return code_point < 0x80 && std::isalnum(static_cast<int>(code_point));
+}
+
+enum class Join : std::uint8_t { Skip, New, Append, AppendWithSpace };
+enum class JoinWarning : std::uint8_t { None, PreviousRow, Punctuation };
+
+struct JoinDecision {
+  Join join_ = Join::Skip;
+  JoinWarning warning_ = JoinWarning::None;
+};
+
+// The decision only depends on the last code point of the previous paragraph,
+// which is that of the previous line, and the first code point of the line
+JoinDecision decide_join(char32_t last, char32_t first, bool connect) {
+  const auto &table = CharTable::instance();
+  const auto first_flags = table[first].flags_;
+  const auto last_flags = table[last].flags_;
+
+  if (last == U'，') {
+    if ((first_flags & (CharTable::Cjk | CharTable::OpeningPunctuation)) ||
+        is_ascii_alnum(first)) {
+      return {Join::Append};
+    }
+    return {Join::New, JoinWarning::PreviousRow};
+  } else if (first_flags & CharTable::ClosingPunctuation) {
+    if (!(last_flags & CharTable::ChinesePunctuation)) {
+      return {Join::Append};
+    }
+    if (first != U'！' && first != U'？') {
+      return {Join::New, JoinWarning::Punctuation};
+    }
+    return {Join::New};
+  } else if (connect &&
+             ((last_flags & CharTable::Cjk) || is_ascii_alpha(last)) &&
+             ((first_flags & CharTable::Cjk) || is_ascii_alpha(first))) {
+    // Only Chinese is joined without a space
+    if ((last_flags & CharTable::Cjk) && (first_flags & CharTable::Cjk)) {
+      return {Join::Append};
+    }
+    return {Join::AppendWithSpace};
+  }
+
+  return {Join::New};
+}
+
+void warn_join(JoinWarning warning, std::string_view str,
+               std::string_view previous_row) {
+  auto &log_queue = LogQueue::instance();
+  if (warning == JoinWarning::PreviousRow) {
+    log_queue.warn_each("Punctuation may be wrong: {}, previous row: {}",
+                        str, previous_row);
+  } else if (warning == JoinWarning::Punctuation) {
+    log_queue.warn_each("Punctuation may be wrong: {}", str);
+  }
 }
 
-bool end_with_chinese(const std::string &str) {
-  return klib::is_cjk(klib::last_code_point(str));
+void append_joined(std::string &paragraph, std::string_view str, Join join) {
+  if (join == Join::AppendWithSpace) {
+    paragraph.push_back(' ');
+  }
+  paragraph.append(str);
 }
 
-bool is_punctuation(char32_t code_point) {
-  return code_point == U'◇' || klib::is_chinese_punctuation(code_point);
+std::string join_lines(std::span<const std::string> lines,
+                       std::span<const JoinDecision> decisions) {
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < std::size(lines); ++i) {
+    size += std::size(lines[i]) +
+            (decisions[i].join_ == Join::AppendWithSpace ? 1 : 0);
+  }
+
+  std::string paragraph;
+  paragraph.reserve(size);
+  for (std::size_t i = 0; i < std::size(lines); ++i) {
+    append_joined(paragraph, lines[i], decisions[i].join_);
+  }
+
+  return paragraph;
 }
 
-bool end_with_punctuation(const std::string &str) {
-  return klib::is_chinese_punctuation(klib::last_code_point(str));
+// Returns the number of CJK characters
+std::int32_t check_line(const std::string &line, bool check) {
+  if (check) {
+    auto &validator = CharValidator::global();
+
+    bool has_unknown = false;
+    for (std::size_t index = 0; index < std::size(line);) {
+      char32_t code_point;
+      if (!next_code_point(line, index, code_point)) [[unlikely]] {
+        klib::error("Invalid UTF-8: {}", line);
+      }
+      has_unknown = has_unknown || !validator.is_known(code_point);
+    }
+
+    // Rare, so the line is decoded again there
+    if (has_unknown) [[unlikely]] {
+      validator.check(line);
+    }
+  }
+
+  return cjk_count(line);
 }
 
+// Indices in formats()
+enum Format { VolumeNameFormat, TitleFormat };
+
+// Both formats in one DFA, shared by every thread
+const re2::RE2::Set &formats() {
+  static const auto set = [] {
+    re2::RE2::Set set(re2::RE2::Options(), re2::RE2::ANCHOR_BOTH);
+    set.Add(R"(第([一二三四五六七八九十]|[0-9]){1,3}卷 .+)", nullptr);
+    set.Add(R"(第([零一二三四五六七八九十百千]|[0-9]){1,7}[章话] .+)", nullptr);
+    if (!set.Compile()) {
+      klib::error("Failed to compile the title formats");
+    }
+    return set;
+  }();
+
+  return set;
+}
+
+bool has_format(std::string_view str, Format format) {
+  std::vector<int> matches;
+  return formats().Match(str, &matches) &&
+         std::find(std::begin(matches), std::end(matches), format) !=
+             std::end(matches);
+}
+
+// A section as it would be appended by push_back()
+struct JoinedSection {
+  std::vector<JoinDecision> decisions_;
+  // The lines before the first new paragraph, appended to the last one
+  std::string leading_;
+  std::vector<std::string> paragraphs_;
+};
+
 }  // namespace
 
 std::string footer_str() {
@@ -106,67 +281,225 @@ void check_is_book_id(const std::string &book_id) {
 
 std::vector<std::string> read_file_to_vec(const std::string &file_name,
                                           bool translation) {
-  std::ifstream ifs(file_name);
-  if (!ifs) {
-    klib::error("Failed to open file: '{}'", file_name);
-  }
+  const MappedFile file(file_name);
+  const auto content = file.view();
+
+  // Chunk i holds the lines that begin in [i * chunk_size, (i + 1) *
+  // chunk_size), so every task finds its own boundaries with memchr(), which
+  // is vectorized, without waiting for the others. With translation, the
+  // boundaries move on to the next section, so no chapter is split
+  constexpr std::size_t chunk_size = 1024 * 1024;
+  const auto chunk_count = (std::size(content) + chunk_size - 1) / chunk_size;
+  const auto line_begin = [&](std::size_t offset) {
+    if (offset == 0) {
+      return offset;
+    }
 
-  std::vector<std::string> result;
-  result.reserve(16384);
+    while (offset < std::size(content)) {
+      const auto newline = content.find('\n', offset - 1);
+      if (newline == std::string_view::npos) {
+        break;
+      }
 
-  std::string line;
-  while (std::getline(ifs, line)) {
-    result.push_back(line);
-  }
+      offset = newline + 1;
+      if (!translation || is_section_start(content.substr(offset))) {
+        return offset;
+      }
+      ++offset;
+    }
 
-  oneapi::tbb::parallel_for_each(result, [&](std::string &str) {
-    str = trans_str(str, translation);
-    if (!klib::validate_utf8(str)) {
-      klib::error("Invalid UTF-8: {}", str);
+    return std::size(content);
+  };
+
+  std::vector<std::vector<std::string>> chunks(chunk_count);
+  oneapi::tbb::parallel_for(std::size_t(0), chunk_count, [&](std::size_t i) {
+    const auto begin = line_begin(i * chunk_size);
+    const auto end = line_begin((i + 1) * chunk_size);
+    if (begin < end) {
+      // The transform rejects invalid UTF-8, so the lines are not validated
+      // again. Empty lines are already dropped
+      chunks[i] =
+          trans_sections(content.substr(begin, end - begin), translation);
     }
   });
 
-  std::erase_if(result,
-                [](const std::string &line) { return std::empty(line); });
+  // Compaction, every chunk is moved to its offset in parallel
+  std::vector<std::size_t> offsets(chunk_count + 1, 0);
+  for (std::size_t i = 0; i < chunk_count; ++i) {
+    offsets[i + 1] = offsets[i] + std::size(chunks[i]);
+  }
+
+  std::vector<std::string> result(offsets.back());
+  oneapi::tbb::parallel_for(std::size_t(0), chunk_count, [&](std::size_t i) {
+    std::move(std::begin(chunks[i]), std::end(chunks[i]),
+              std::begin(result) + static_cast<std::ptrdiff_t>(offsets[i]));
+  });
 
   return result;
 }
 
+void write_file_atomically(const std::string &path, const std::string &data) {
+  const auto temp_path =
+      path + "." + std::to_string(getpid()) + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+
+  klib::write_file(temp_path, true, data);
+  std::filesystem::rename(temp_path, path);
+}
+
 void str_check(const std::string &str) {
-  static phmap::flat_hash_set<char32_t> set;
+  CharValidator::global().check(str);
+}
 
-  auto copy = str;
-  std::erase_if(copy, [](char c) { return std::isalnum(c) || c == ' '; });
+std::int32_t str_size(const std::string &str) { return cjk_count(str); }
 
-  for (auto c : klib::utf8_to_utf32(copy)) {
-    if (!klib::is_cjk(c) && !is_punctuation(c)) {
-      if (set.contains(c)) {
-        continue;
+std::int32_t append_lines(std::vector<std::string> &texts,
+                          std::span<const std::string> lines, bool connect,
+                          bool check) {
+  const Section section = {&texts, lines};
+  return append_sections(std::span(&section, 1), connect, check);
+}
+
+std::int32_t append_sections(std::span<const Section> sections, bool connect,
+                             bool check) {
+  const auto section_count = std::size(sections);
+
+  // The last code point before each section, sections may share their texts
+  std::vector<std::optional<char32_t>> previous(section_count);
+  phmap::flat_hash_map<const std::vector<std::string> *,
+                       std::optional<char32_t>>
+      last_of;
+  for (std::size_t i = 0; i < section_count; ++i) {
+    const auto &[texts, lines] = sections[i];
+    const auto [iter, _] = last_of.try_emplace(
+        texts, std::empty(*texts)
+                   ? std::optional<char32_t>()
+                   : std::optional<char32_t>(last_code_point(texts->back())));
+    previous[i] = iter->second;
+
+    if (const auto last = std::find_if(
+            std::rbegin(lines), std::rend(lines),
+            [](const std::string &line) { return !std::empty(line); });
+        last != std::rend(lines)) {
+      iter->second = last_code_point(*last);
+    }
+  }
+
+  std::atomic<std::int32_t> word_count = 0;
+  std::vector<JoinedSection> joined(section_count);
+  oneapi::tbb::parallel_for(std::size_t(0), section_count, [&](std::size_t i) {
+    const auto lines = sections[i].lines_;
+    const auto size = std::size(lines);
+    auto &[decisions, leading, paragraphs] = joined[i];
+    decisions.resize(size);
+
+    oneapi::tbb::parallel_for(
+        oneapi::tbb::blocked_range<std::size_t>(0, size),
+        [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+          std::int32_t count = 0;
+          for (auto j = range.begin(); j != range.end(); ++j) {
+            const auto &line = lines[j];
+            if (std::empty(line)) {
+              continue;
+            }
+            count += check_line(line, check);
+
+            // Usually the line before
+            auto last = previous[i];
+            for (auto k = j; k > 0; --k) {
+              if (!std::empty(lines[k - 1])) {
+                last = last_code_point(lines[k - 1]);
+                break;
+              }
+            }
+
+            decisions[j] = last ? decide_join(*last, first_code_point(line),
+                                              connect)
+                                : JoinDecision{Join::New};
+          }
+          word_count.fetch_add(count, std::memory_order_relaxed);
+        });
+
+    std::vector<std::size_t> begins;
+    for (std::size_t j = 0; j < size; ++j) {
+      if (decisions[j].join_ == Join::New) {
+        begins.push_back(j);
       }
+    }
+    begins.push_back(size);
+
+    const std::span<const JoinDecision> decision_span = decisions;
+    leading = join_lines(lines.first(begins.front()),
+                         decision_span.first(begins.front()));
+
+    paragraphs.resize(std::size(begins) - 1);
+    oneapi::tbb::parallel_for(
+        std::size_t(0), std::size(paragraphs), [&](std::size_t j) {
+          const auto begin = begins[j];
+          const auto count = begins[j + 1] - begin;
+          paragraphs[j] = join_lines(lines.subspan(begin, count),
+                                     decision_span.subspan(begin, count));
+        });
+  });
 
-      set.insert(c);
+  for (std::size_t i = 0; i < section_count; ++i) {
+    auto &texts = *sections[i].texts_;
+    auto &[decisions, leading, paragraphs] = joined[i];
 
-      klib::warn("Unknown character: {} in {}", klib::utf32_to_utf8(c), str);
+    // Index of the paragraph after the one the line is appended to
+    auto next = std::size(texts);
+    if (!std::empty(leading)) {
+      texts.back().append(leading);
+    }
+    texts.insert(std::end(texts),
+                 std::make_move_iterator(std::begin(paragraphs)),
+                 std::make_move_iterator(std::end(paragraphs)));
+
+    if (!check) {
+      continue;
+    }
+    // In the original order, the previous row is complete by the time a line
+    // starts a new paragraph
+    const auto lines = sections[i].lines_;
+    for (std::size_t j = 0; j < std::size(lines); ++j) {
+      const auto [join, warning] = decisions[j];
+      if (warning != JoinWarning::None) {
+        warn_join(warning, lines[j], texts[next - 1]);
+      }
+      if (join == Join::New) {
+        ++next;
+      }
     }
   }
-}
+  LogQueue::instance().flush();
 
-std::int32_t str_size(const std::string &str) {
-  std::int32_t count = 0;
+  return word_count;
+}
 
-  for (auto c : klib::utf8_to_utf32(str)) {
-    if (klib::is_cjk(c)) {
-      ++count;
+std::int32_t check_novel(const Novel &novel, bool check) {
+  std::vector<const std::vector<std::string> *> sections = {
+      &novel.book_info_.introduction_, &novel.postscript_};
+  for (const auto &volume : novel.volumes_) {
+    for (const auto &chapter : volume.chapters_) {
+      sections.push_back(&chapter.texts_);
     }
   }
 
-  return count;
+  std::atomic<std::int32_t> word_count = 0;
+  oneapi::tbb::parallel_for_each(sections, [&](const auto *texts) {
+    std::int32_t count = 0;
+    for (const auto &line : *texts) {
+      count += check_line(line, check);
+    }
+    word_count.fetch_add(count, std::memory_order_relaxed);
+  });
+
+  return word_count;
 }
 
 void volume_name_check(const std::string &volume_name) {
-  const static re2::RE2 regex = R"(第([一二三四五六七八九十]|[0-9]){1,3}卷 .+)";
-
-  if (!re2::RE2::FullMatch(volume_name, regex)) {
+  if (!has_format(volume_name, VolumeNameFormat)) {
     klib::warn("Irregular volume name format: {}", volume_name);
     return;
   }
@@ -175,10 +508,7 @@ void volume_name_check(const std::string &volume_name) {
 }
 
 void title_check(const std::string &title) {
-  const static re2::RE2 regex =
-      R"(第([零一二三四五六七八九十百千]|[0-9]){1,7}[章话] .+)";
-
-  if (!re2::RE2::FullMatch(title, regex)) {
+  if (!has_format(title, TitleFormat)) {
     klib::warn("Irregular title format: {}", title);
     return;
   }
@@ -186,70 +516,88 @@ void title_check(const std::string &title) {
   str_check(title);
 }
 
-void push_back(std::vector<std::string> &texts, const std::string &str,
+void titles_check(std::span<const std::string> volume_names,
+                  std::span<const std::string> titles) {
+  const auto volume_name_count = std::size(volume_names);
+  const auto count = volume_name_count + std::size(titles);
+
+  std::vector<std::uint8_t> irregular(count);
+  oneapi::tbb::parallel_for(std::size_t(0), count, [&](std::size_t i) {
+    const auto is_title = i >= volume_name_count;
+    const auto &str =
+        is_title ? titles[i - volume_name_count] : volume_names[i];
+
+    if (has_format(str, is_title ? TitleFormat : VolumeNameFormat)) {
+      str_check(str);
+    } else {
+      irregular[i] = true;
+    }
+  });
+
+  std::string message;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!irregular[i]) {
+      continue;
+    }
+
+    if (!std::empty(message)) {
+      message.push_back('\n');
+    }
+    if (i < volume_name_count) {
+      message.append("Irregular volume name format: ").append(volume_names[i]);
+    } else {
+      message.append("Irregular title format: ")
+          .append(titles[i - volume_name_count]);
+    }
+  }
+
+  if (!std::empty(message)) {
+    klib::warn("{}", message);
+  }
+}
+
+void push_back(std::vector<std::string> &texts, std::string_view str,
                bool connect, bool check) {
   if (std::empty(str)) {
     return;
   }
 
   if (std::empty(texts)) {
-    texts.push_back(str);
+    texts.emplace_back(str);
     return;
   }
 
-  if (texts.back().ends_with("，")) {
-    if ((start_with_chinese(str) || std::isalnum(str.front())) ||
-        (str.starts_with("—") || str.starts_with("“") ||
-         str.starts_with("「") || str.starts_with("『") ||
-         str.starts_with("《") || str.starts_with("[") ||
-         str.starts_with("【") || str.starts_with("（"))) {
-      texts.back().append(str);
-    } else {
-      if (check) {
-        klib::warn("Punctuation may be wrong: {}, previous row: {}", str,
-                   texts.back());
-      }
-      texts.push_back(str);
-    }
-  } else if (str.starts_with("！") || str.starts_with("？") ||
-             str.starts_with("，") || str.starts_with("。") ||
-             str.starts_with("、") || str.starts_with("”") ||
-             str.starts_with("」") || str.starts_with("』") ||
-             str.starts_with("》") || str.starts_with("]") ||
-             str.starts_with("】") || str.starts_with("）")) {
-    if (!end_with_punctuation(texts.back())) {
-      texts.back().append(str);
-    } else {
-      if (check) {
-        if (!(str.starts_with("！") || str.starts_with("？"))) {
-          klib::warn("Punctuation may be wrong: {}", str);
-        }
-      }
-      texts.push_back(str);
-    }
-  } else if (connect && std::isalpha(texts.back().back()) &&
-             std::isalpha(str.front())) {
-    texts.back().append(" " + str);
-  } else if (connect && end_with_chinese(texts.back()) &&
-             std::isalpha(str.front())) {
-    texts.back().append(" " + str);
-  } else if (connect && std::isalpha(texts.back().back()) &&
-             start_with_chinese(str)) {
-    texts.back().append(" " + str);
-  } else if (connect && end_with_chinese(texts.back()) &&
-             start_with_chinese(str)) {
-    texts.back().append(str);
+  auto &back = texts.back();
+  const auto [join, warning] =
+      decide_join(last_code_point(back), first_code_point(str), connect);
+  if (check) {
+    warn_join(warning, str, back);
+  }
+
+  if (join == Join::New) {
+    texts.emplace_back(str);
   } else {
-    texts.push_back(str);
+    append_joined(back, str, join);
   }
 }
 
-void push_back(std::vector<std::string> &texts, const std::string &str) {
-  if (auto std_str = klib::trim_copy(str); !std::empty(std_str)) {
-    texts.push_back(std::move(std_str));
+void push_back(std::vector<std::string> &texts, std::string_view str) {
+  if (const auto line = trim(str); !std::empty(line)) {
+    texts.emplace_back(line);
   }
 }
 
+void push_back(std::vector<std::string> &texts, std::string &&str) {
+  klib::trim(str);
+  if (!std::empty(str)) {
+    texts.push_back(std::move(str));
+  }
+}
+
+void push_back(std::vector<std::string> &texts, const char *str) {
+  push_back(texts, std::string_view(str));
+}
+
 std::string get_login_name() {
   std::string login_name;
 
@@ -332,76 +680,83 @@ std::string make_book_name_legal(const std::string &file_name) {
   return new_file_name;
 }
 
+void number_images(std::vector<Volume> &volumes) {
+  constexpr std::string_view image_prefix = "[IMAGE] ";
+
+  std::int32_t image_count = 1;
+  // old_name new_name
+  phmap::flat_hash_map<std::string, std::string> image_name_map;
+  for (auto &volume : volumes) {
+    for (auto &chapter : volume.chapters_) {
+      std::vector<std::string> texts;
+      texts.reserve(std::size(chapter.texts_));
+
+      for (auto &line : chapter.texts_) {
+        if (line.starts_with(image_prefix)) [[unlikely]] {
+          const auto image_name = line.substr(std::size(image_prefix));
+
+          auto iter = image_name_map.find(image_name);
+          if (iter == std::end(image_name_map)) {
+            if (!std::filesystem::exists(image_name)) {
+              klib::warn("Image not exists: {}", image_name);
+              continue;
+            }
+
+            const auto ext = check_is_supported_format(image_name);
+            if (!ext) {
+              continue;
+            }
+
+            auto new_image_name = num_to_str(image_count++) + *ext;
+            std::filesystem::rename(image_name, new_image_name);
+            iter = image_name_map.emplace(image_name, new_image_name).first;
+          }
+
+          line = std::string(image_prefix) + iter->second;
+        }
+
+        texts.push_back(std::move(line));
+      }
+
+      chapter.texts_ = std::move(texts);
+    }
+  }
+}
+
 void generate_txt(const BookInfo &book_info,
                   const std::vector<Volume> &volumes) {
-  std::ostringstream oss;
+  FileWriter writer(make_book_name_legal(book_info.name_) + ".txt");
 
-  oss << "[AUTHOR]"
-      << "\n\n";
-  oss << book_info.author_ << "\n\n";
+  writer.write("[AUTHOR]").write("\n\n");
+  writer.write(book_info.author_).write("\n\n");
 
-  oss << "[INTRO]"
-      << "\n\n";
+  writer.write("[INTRO]").write("\n\n");
   for (const auto &line : book_info.introduction_) {
-    oss << line << "\n";
+    writer.write(line).write('\n');
   }
-  oss << "\n";
+  // The file does not end with an empty line
+  writer.write_if_followed('\n');
 
-  // old_name new_name
-  phmap::flat_hash_map<std::string, std::string> image_name_map;
   for (const auto &volume : volumes) {
     if (std::empty(volume.chapters_)) {
       continue;
     }
 
     if (!std::empty(volume.title_)) {
-      oss << "[VOLUME] " << volume.title_ << "\n\n";
+      writer.write("[VOLUME] ").write(volume.title_).write("\n\n");
     }
 
     for (const auto &chapter : volume.chapters_) {
-      oss << "[WEB] " << chapter.title_ << "\n\n";
+      writer.write("[WEB] ").write(chapter.title_).write("\n\n");
 
       for (const auto &line : chapter.texts_) {
-        static std::int32_t image_count = 1;
-        const static std::string image_prefix = "[IMAGE] ";
-        const static auto image_prefix_size = std::size(image_prefix);
-
-        if (line.starts_with(image_prefix)) [[unlikely]] {
-          auto image_name = line.substr(image_prefix_size);
-
-          if (auto iter = image_name_map.find(image_name);
-              iter != std::end(image_name_map)) {
-            oss << image_prefix << iter->second << '\n';
-          } else {
-            if (!std::filesystem::exists(image_name)) {
-              klib::warn("Image not exists: {}", image_name);
-              continue;
-            }
-
-            auto ext = check_is_supported_format(image_name);
-
-            if (ext) {
-              auto new_image_name = num_to_str(image_count++) + *ext;
-              oss << image_prefix << new_image_name << '\n';
-              std::filesystem::rename(image_name, new_image_name);
-
-              image_name_map.emplace(image_name, new_image_name);
-            }
-          }
-        } else [[likely]] {
-          oss << line << '\n';
-        }
+        writer.write(line).write('\n');
       }
-      oss << '\n';
+      writer.write_if_followed('\n');
     }
   }
 
-  std::string str = oss.str();
-  // '\n'
-  str.pop_back();
-
-  std::ofstream book_ofs(make_book_name_legal(book_info.name_) + ".txt");
-  book_ofs << str << std::flush;
+  writer.close();
 }
 
 }  // namespace kepub
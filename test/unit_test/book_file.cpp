@@ -0,0 +1,84 @@
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <klib/util.h>
+
+#include "book_file.h"
+#include "util.h"
+
+TEST_CASE("BookFile", "[book_file]") {
+  const std::string file_name = "book_file_test.kepub";
+
+  kepub::BookInfo book_info;
+  book_info.name_ = "书名";
+  book_info.author_ = "作者";
+  book_info.introduction_ = {"简介第一行", "简介第二行"};
+
+  std::vector<kepub::Volume> volumes(3);
+  volumes[0].title_ = "第一卷";
+  volumes[0].chapters_.emplace_back(
+      "第一章", std::vector<std::string>{"第一段", "", "[IMAGE] 001.jpg"});
+  volumes[0].chapters_.emplace_back("第二章", std::vector<std::string>());
+  // volumes[1] is left empty, it is skipped as in the txt file
+  volumes[2].title_ = "第二卷";
+  volumes[2].chapters_.emplace_back("第三章", std::vector<std::string>{"abc"});
+
+  kepub::BookFile::write(file_name, book_info, volumes, {"后记"});
+
+  {
+    const kepub::BookFile book_file(file_name);
+    CHECK(book_file.name() == "书名");
+    CHECK(book_file.author() == "作者");
+
+    const auto novel = book_file.novel();
+    CHECK(novel.book_info_.name_ == book_info.name_);
+    CHECK(novel.book_info_.author_ == book_info.author_);
+    CHECK(novel.book_info_.introduction_ == book_info.introduction_);
+    CHECK(novel.postscript_ == std::vector<std::string>{"后记"});
+
+    const std::vector<kepub::Volume> written = {volumes[0], volumes[2]};
+    REQUIRE(std::size(novel.volumes_) == std::size(written));
+    for (std::size_t i = 0; i < std::size(written); ++i) {
+      CHECK(novel.volumes_[i].title_ == written[i].title_);
+
+      const auto &chapters = novel.volumes_[i].chapters_;
+      REQUIRE(std::size(chapters) == std::size(written[i].chapters_));
+      for (std::size_t j = 0; j < std::size(chapters); ++j) {
+        CHECK(chapters[j].title_ == written[i].chapters_[j].title_);
+        CHECK(chapters[j].texts_ == written[i].chapters_[j].texts_);
+      }
+    }
+
+    // The lines of the txt file, without the empty ones, are those of the
+    // novel read back
+    std::vector<std::string> lines = {"[AUTHOR]", novel.book_info_.author_,
+                                      "[INTRO]"};
+    lines.insert(std::end(lines), std::begin(novel.book_info_.introduction_),
+                 std::end(novel.book_info_.introduction_));
+    for (const auto &volume : novel.volumes_) {
+      lines.push_back("[VOLUME] " + volume.title_);
+      for (const auto &chapter : volume.chapters_) {
+        lines.push_back("[WEB] " + chapter.title_);
+        for (const auto &line : chapter.texts_) {
+          if (!std::empty(line)) {
+            lines.push_back(line);
+          }
+        }
+      }
+    }
+
+    kepub::generate_txt(book_info, volumes);
+    const auto txt_name = book_info.name_ + ".txt";
+    CHECK(kepub::read_file_to_vec(txt_name, false) == lines);
+    std::filesystem::remove(txt_name);
+  }
+
+  // Truncated in the middle of the string table
+  const auto data = klib::read_file(file_name, true);
+  klib::write_file(file_name, true, data.substr(0, std::size(data) / 2));
+  CHECK_THROWS(kepub::BookFile(file_name));
+
+  std::filesystem::remove(file_name);
+}
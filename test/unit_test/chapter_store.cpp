@@ -0,0 +1,85 @@
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <klib/util.h>
+
+#include "chapter_store.h"
+
+TEST_CASE("ChapterStore", "[chapter_store]") {
+  const std::string path = "chapter_store_test";
+  const kepub::ChapterStore store(path);
+
+  const std::vector<std::string> texts = {"第一段", "", "abc"};
+  const auto hash = store.put(texts);
+  CHECK(std::size(hash) == 64);
+  CHECK(store.put(texts) == hash);
+  CHECK(store.put({"第一段", "abc"}) != hash);
+  CHECK(store.get(hash) == texts);
+  CHECK_FALSE(store.get(std::string(64, '0')));
+
+  CHECK_FALSE(store.find_source("source"));
+  store.link_source("source", hash);
+  CHECK(store.find_source("source") == hash);
+
+  kepub::BookInfo book_info;
+  book_info.name_ = "书名";
+  book_info.author_ = "作者";
+  book_info.introduction_ = {"简介"};
+
+  std::vector<kepub::Volume> volumes(2);
+  volumes[0].chapters_.emplace_back("第一章", texts);
+  volumes[1].title_ = "第二卷";
+  volumes[1].chapters_.emplace_back("", texts);
+  volumes[1].chapters_.emplace_back("第三章", std::vector<std::string>());
+  store.add_book(book_info, volumes);
+
+  // The same chapter is only stored once
+  std::size_t chapter_count = 0;
+  for (const auto &entry :
+       std::filesystem::recursive_directory_iterator(path + "/chapters")) {
+    chapter_count += entry.is_regular_file();
+  }
+  CHECK(chapter_count == 4);
+
+  const auto novel = store.load_book("书名");
+  REQUIRE(novel);
+  CHECK(novel->book_info_.author_ == "作者");
+  CHECK(novel->book_info_.introduction_ == book_info.introduction_);
+  CHECK(std::empty(novel->postscript_));
+  REQUIRE(std::size(novel->volumes_) == 2);
+  CHECK(std::empty(novel->volumes_[0].title_));
+  CHECK(novel->volumes_[1].title_ == "第二卷");
+  REQUIRE(std::size(novel->volumes_[1].chapters_) == 2);
+  CHECK(std::empty(novel->volumes_[1].chapters_[0].title_));
+  CHECK(novel->volumes_[1].chapters_[0].texts_ == texts);
+  CHECK(novel->volumes_[1].chapters_[1].title_ == "第三章");
+  CHECK(std::empty(novel->volumes_[1].chapters_[1].texts_));
+  CHECK_FALSE(store.load_book("其他"));
+
+  // Images of the same name in two books are different images
+  std::vector<kepub::Volume> image_volumes(1);
+  image_volumes[0].chapters_.emplace_back(
+      "第一章", std::vector<std::string>{"第一段", "[IMAGE] 001.jpg"});
+  std::vector<std::string> image_lines;
+  for (const std::string data : {"first image", "second image"}) {
+    klib::write_file("001.jpg", true, data);
+
+    book_info.name_ = data;
+    store.add_book(book_info, image_volumes);
+
+    const auto book = store.load_book(data);
+    REQUIRE(book);
+    const auto &image_line = book->volumes_[0].chapters_[0].texts_[1];
+    REQUIRE(image_line.starts_with("[IMAGE] "));
+    CHECK(image_line.ends_with(".jpg"));
+    CHECK(klib::read_file(store.image_path(image_line.substr(8)), true) ==
+          data);
+    image_lines.push_back(image_line);
+  }
+  CHECK(image_lines[0] != image_lines[1]);
+  std::filesystem::remove("001.jpg");
+
+  std::filesystem::remove_all(path);
+}
@@ -0,0 +1,20 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "char_table.h"
+
+TEST_CASE("CharTable", "[char_table]") {
+  const auto &table = kepub::CharTable::instance();
+
+  CHECK(table[U'妳'].to_ == u'你');
+  CHECK(table[U'Ａ'].to_ == u'A');
+  CHECK(table[U'幺'].to_ == 0);
+  CHECK(table[U'幺'].to_translation_ == u'么');
+  CHECK(table[U'中'].to_ == 0);
+
+  CHECK(table.is(U'​', kepub::CharTable::Drop));
+  CHECK(table.is(U'　', kepub::CharTable::Whitespace));
+  CHECK(table.is(U'，', kepub::CharTable::ChinesePunctuation));
+  CHECK(table.is(U'?', kepub::CharTable::EnglishPunctuation));
+  CHECK(table.is(U'中', kepub::CharTable::Cjk));
+  CHECK(!table.is(U'😀', kepub::CharTable::Cjk));
+}
@@ -0,0 +1,22 @@
+#include <string>
+#include <vector>
+
+#include <oneapi/tbb.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "char_validator.h"
+
+TEST_CASE("CharValidator", "[char_validator]") {
+  kepub::CharValidator validator;
+
+  validator.check("第一行，abc 123◇");
+  REQUIRE(validator.size() == 0);
+
+  const std::vector<std::string> lines(1000, "★第二行☆");
+  oneapi::tbb::parallel_for_each(
+      lines, [&](const std::string &line) { validator.check(line); });
+  REQUIRE(validator.size() == 2);
+
+  validator.report();
+  REQUIRE(validator.size() == 0);
+}
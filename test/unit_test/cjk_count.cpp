@@ -0,0 +1,34 @@
+#include <cstdint>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "char_table.h"
+#include "cjk_count.h"
+#include "utf8.h"
+
+TEST_CASE("cjk_count", "[cjk_count]") {
+  CHECK(kepub::cjk_count("") == 0);
+  CHECK(kepub::cjk_count("abc，第一章") == 3);
+
+  // Every lead byte, both in the vectorized loop and in the tail
+  std::string str;
+  std::int32_t expected = 0;
+  for (char32_t code_point = 0x80; code_point < 0x30000; code_point += 7) {
+    if (code_point >= 0xD800 && code_point < 0xE000) {
+      continue;
+    }
+
+    kepub::append_code_point(str, code_point);
+    expected += kepub::CharTable::instance().is(code_point,
+                                                kepub::CharTable::Cjk);
+  }
+
+  CHECK(kepub::cjk_count(str) == expected);
+
+  str.clear();
+  for (std::int32_t size = 0; size < 40; ++size) {
+    CHECK(kepub::cjk_count(str) == size);
+    str.append("中a");
+  }
+}
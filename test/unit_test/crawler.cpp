@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <klib/exception.h>
+
+#include "crawler.h"
+
+namespace {
+
+class FakeAdapter : public kepub::SiteAdapter {
+ public:
+  std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
+      const std::string &) override {
+    kepub::BookInfo book_info;
+    book_info.name_ = "book";
+
+    std::vector<kepub::Volume> volumes(1);
+    volumes.front().chapters_.emplace_back(1, "chapter");
+
+    return {book_info, volumes};
+  }
+
+  std::string fetch_chapter(const kepub::Chapter &) override {
+    if (++fetch_count_ < 2) {
+      throw klib::RuntimeError("Network error");
+    }
+    return "  first  \n\n[img]ignored\nsecond\n";
+  }
+
+  bool is_image(std::string_view line) const override {
+    return line.starts_with("[img]");
+  }
+
+  std::optional<std::string> image_url(std::string_view) const override {
+    return {};
+  }
+
+  std::string get_image(const std::string &) override { return ""; }
+
+  void write(kepub::BookInfo &, std::vector<kepub::Volume> &volumes) override {
+    texts_ = volumes.front().chapters_.front().texts_;
+  }
+
+  std::int32_t fetch_count_ = 0;
+  std::vector<std::string> texts_;
+};
+
+class ExpiringAdapter : public FakeAdapter {
+ public:
+  std::pair<std::string, std::string> read_credentials() override {
+    return {"name", "password"};
+  }
+
+  void login(const std::string &, const std::string &) override {
+    ++login_count_;
+  }
+
+  std::string fetch_chapter(const kepub::Chapter &) override {
+    if (++fetch_count_ < 2) {
+      throw kepub::LoginExpiredError("Login expired");
+    }
+    return "text\n";
+  }
+
+  std::int32_t login_count_ = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Crawler", "[crawler]") {
+  FakeAdapter adapter;
+  kepub::Crawler(adapter, kepub::CrawlOptions()).run("1");
+
+  CHECK(adapter.fetch_count_ == 2);
+  CHECK(adapter.texts_ == std::vector<std::string>{"first", "second"});
+}
+
+TEST_CASE("Crawler login expired", "[crawler]") {
+  ExpiringAdapter adapter;
+  kepub::Crawler(adapter, kepub::CrawlOptions()).run("1");
+
+  CHECK(adapter.login_count_ == 1);
+  CHECK(adapter.fetch_count_ == 2);
+  CHECK(adapter.texts_ == std::vector<std::string>{"text"});
+}
@@ -0,0 +1,29 @@
+#include <filesystem>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+#include <klib/util.h>
+
+#include "file_writer.h"
+
+TEST_CASE("FileWriter", "[file_writer]") {
+  const std::string file_name = "file_writer_test.txt";
+  // Larger than the buffer
+  const std::string large(3 << 20, 'a');
+
+  {
+    kepub::FileWriter writer(file_name);
+    writer.write("第一行").write('\n').write_if_followed('\n');
+    writer.write(large).write_if_followed('\n');
+    writer.close();
+  }
+  REQUIRE(klib::read_file(file_name, false) == "第一行\n\n" + large);
+
+  {
+    kepub::FileWriter writer(file_name);
+    writer.close();
+  }
+  REQUIRE(std::empty(klib::read_file(file_name, false)));
+
+  std::filesystem::remove(file_name);
+}
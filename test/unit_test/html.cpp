@@ -23,3 +23,16 @@ TEST_CASE("HTML", "[html]") {
     CHECK(result == std::vector<std::string>{results[index++]});
   }
 }
+
+TEST_CASE("get_node_lines", "[html]") {
+  pugi::xml_document doc;
+  doc.load_string(
+      R"(<div><p>第一段</p><p>第二段<br/>第三段</p><img src="https://a.com/1.jpg"/></div>)");
+
+  const auto lines = kepub::get_node_lines(doc);
+  const std::vector<std::string> result(std::begin(lines), std::end(lines));
+  CHECK(result == std::vector<std::string>{"第一段", "第二段", "第三段",
+                                           "[IMAGE] https://a.com/1.jpg"});
+  CHECK(lines.buffer() ==
+        "第一段\n第二段\n第三段\n[IMAGE] https://a.com/1.jpg\n");
+}
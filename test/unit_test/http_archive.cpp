@@ -0,0 +1,36 @@
+#include <filesystem>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "http_archive.h"
+
+TEST_CASE("http_key", "[http_archive]") {
+  phmap::flat_hash_map<std::string, std::string> a{{"a", "1"}, {"b", "2"}};
+  phmap::flat_hash_map<std::string, std::string> b{{"b", "2"}, {"a", "1"}};
+
+  CHECK(kepub::http_key("POST", "https://a.com", a) ==
+        kepub::http_key("POST", "https://a.com", b));
+  CHECK(kepub::http_key("GET", "https://a.com") !=
+        kepub::http_key("POST", "https://a.com"));
+}
+
+TEST_CASE("HttpArchive", "[http_archive]") {
+  const std::string path = "http_archive_test";
+  std::filesystem::remove_all(path);
+
+  kepub::HttpArchiveOptions options;
+  options.mode_ = kepub::HttpMode::Record;
+  options.path_ = path;
+  kepub::HttpArchive record(options);
+
+  const auto key = kepub::http_key("GET", "https://a.com");
+  CHECK(record.fetch(key, [] { return std::string("response"); }) ==
+        "response");
+
+  options.mode_ = kepub::HttpMode::Replay;
+  kepub::HttpArchive replay(options);
+  CHECK(replay.fetch(key, [] { return std::string(); }) == "response");
+
+  std::filesystem::remove_all(path);
+}
@@ -0,0 +1,35 @@
+#include <cstddef>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "line_cache.h"
+
+TEST_CASE("LineCache", "[line_cache]") {
+  // 16 shards of 4 bytes each
+  kepub::LineCache cache(64);
+
+  CHECK_FALSE(cache.find("a"));
+  cache.insert("a", "b");
+  CHECK(cache.find("a") == "b");
+
+  // Too large for a shard
+  cache.insert("abc", "def");
+  CHECK_FALSE(cache.find("abc"));
+
+  // Evicts the least recently used entries of the shard
+  for (std::size_t i = 0; i < 100; ++i) {
+    cache.insert(std::to_string(i), "x");
+  }
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < 100; ++i) {
+    if (cache.find(std::to_string(i))) {
+      ++found;
+    }
+  }
+  CHECK(found <= 16 * 2);
+
+  const auto stats = cache.stats();
+  CHECK(stats.hits_ == 1 + found);
+  CHECK(stats.misses_ == 2 + 100 - found);
+}
@@ -0,0 +1,27 @@
+#include <cstdint>
+#include <string>
+
+#include <oneapi/tbb.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "log_queue.h"
+
+TEST_CASE("LogQueue", "[log_queue]") {
+  kepub::LogQueue log_queue(kepub::LogLevel::Warn);
+  REQUIRE(log_queue.enabled(kepub::LogLevel::Warn));
+  CHECK_FALSE(log_queue.enabled(kepub::LogLevel::Info));
+
+  oneapi::tbb::parallel_for(std::int32_t(0), std::int32_t(100),
+                            [&](std::int32_t i) {
+                              const std::string line = std::to_string(i);
+                              log_queue.warn("Repeated warning: {}", line);
+                            });
+  log_queue.warn("Another warning: {}", "line");
+  for (std::int32_t i = 0; i < 20; ++i) {
+    log_queue.warn_each("Warning of a line: {}", i);
+  }
+  log_queue.info("Not logged: {}", 1);
+  log_queue.flush();
+
+  REQUIRE(log_queue.suppressed() == 100 - kepub::LogQueue::repeat_limit);
+}
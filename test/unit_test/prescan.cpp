@@ -0,0 +1,25 @@
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "prescan.h"
+
+TEST_CASE("Prescan", "[prescan]") {
+  const kepub::Prescan prescan(kepub::CharTable::instance(),
+                               {{"赤果", "赤裸"}, {"廿", "二十"}});
+
+  CHECK(prescan.is_clean(""));
+  CHECK(prescan.is_clean("  你好，世界。"));
+  CHECK(prescan.is_clean("“Hello World”"));
+  CHECK(prescan.is_clean(std::string(100, 'a') + "中文"));
+
+  CHECK_FALSE(prescan.is_clean("妳好"));
+  CHECK_FALSE(prescan.is_clean("你好。。"));
+  CHECK_FALSE(prescan.is_clean("你好 。"));
+  CHECK_FALSE(prescan.is_clean("。 你好"));
+  CHECK_FALSE(prescan.is_clean("赤果"));
+  CHECK_FALSE(prescan.is_clean("\xE4\xBD"));
+  CHECK_FALSE(prescan.is_clean(std::string(100, 'a') + "?"));
+  CHECK_FALSE(prescan.is_clean(std::string(31, 'a') + " ."));
+  CHECK_FALSE(prescan.is_clean("a\tb"));
+}
@@ -0,0 +1,27 @@
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "replace.h"
+
+TEST_CASE("Replacer", "[replace]") {
+  const kepub::Replacer replacer(
+      {{"赤果果", "赤裸裸"}, {"赤果", "赤裸"}, {"廿", "二十"}, {"abcde", "X"},
+       {"bcd", "Y"}});
+
+  std::string str = "赤果果赤果，廿";
+  replacer.replace(str);
+  CHECK(str == "赤裸裸赤裸，二十");
+
+  str = "abcdbcd";
+  replacer.replace(str);
+  CHECK(str == "aYY");
+
+  str = "abcde";
+  replacer.replace(str);
+  CHECK(str == "X");
+
+  str = "nothing";
+  replacer.replace(str);
+  CHECK(str == "nothing");
+}
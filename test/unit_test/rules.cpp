@@ -0,0 +1,45 @@
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "rules.h"
+
+TEST_CASE("parse_rules", "[rules]") {
+  const auto rule_set = kepub::parse_rules(
+      "# comment\n"
+      "char 妳 您\n"
+      "phrase 其它 其他 # comment\n"
+      "[esjzone]\n"
+      "phrase 其它 其余\n"
+      "[masiro]\n"
+      "char a b\n"
+      "[*]\n"
+      "translation-char 么 幺\n",
+      "esjzone");
+
+  CHECK(rule_set.chars_ == kepub::CharTable::Map{{U'妳', U'您'}});
+  CHECK(rule_set.translation_chars_ == kepub::CharTable::Map{{U'么', U'幺'}});
+  REQUIRE(std::size(rule_set.phrases_) == 2);
+  CHECK(rule_set.phrases_.front().second == "其余");
+}
+
+TEST_CASE("Rules", "[rules]") {
+  const kepub::Rules rules(
+      kepub::parse_rules("char 妳 您\nphrase 其它 其他", ""));
+  CHECK(rules.table()[U'妳'].to_ == u'您');
+
+  std::string str = "其它赤果";
+  rules.phrases(false).replace(str);
+  CHECK(str == "其他赤裸");
+  CHECK_FALSE(rules.prescan().is_clean("其它"));
+
+  std::string data;
+  rules.serialize(data);
+  const auto loaded = kepub::Rules::deserialize(data);
+  REQUIRE(loaded);
+
+  std::string loaded_data;
+  loaded->serialize(loaded_data);
+  CHECK(loaded_data == data);
+  CHECK_FALSE(kepub::Rules::deserialize(data.substr(1)));
+}
@@ -0,0 +1,27 @@
+#include <chrono>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "session.h"
+
+TEST_CASE("Session", "[session]") {
+  // In the build directory, not in $HOME
+  kepub::Session session("unit_test", std::chrono::hours(1), ".");
+  session.invalidate();
+  CHECK(!session.is_fresh("token"));
+
+  session.validated("token");
+  CHECK(session.is_fresh("token"));
+
+  // Other credentials invalidate the session
+  CHECK(!session.is_fresh("other token"));
+  CHECK(!session.is_fresh("token"));
+
+  session.validated("token");
+  session.invalidate();
+  CHECK(!session.is_fresh("token"));
+
+  kepub::Session disabled("unit_test", std::chrono::seconds(0), ".");
+  disabled.validated("token");
+  CHECK(!disabled.is_fresh("token"));
+}
@@ -1,3 +1,6 @@
+#include <string>
+#include <vector>
+
 #include <catch2/catch_test_macros.hpp>
 
 #include "trans.h"
@@ -10,3 +13,30 @@ TEST_CASE("trans_str", "[trans]") {
   CHECK(kepub::trans_str("，，，", false) == "，");
   CHECK(kepub::trans_str("安　装", false) == "安 装");
 }
+
+TEST_CASE("trans_str UTF-8", "[trans]") {
+  CHECK(kepub::trans_str("&nbsp;赤果果 ~", false) == "赤裸裸 ～");
+  CHECK(kepub::trans_str("廿卅。。", false) == "二十三十。");
+  CHECK_THROWS(kepub::trans_str("\xE5\xAE", false));
+  CHECK_THROWS(kepub::trans_str("\xC0\xAF", false));
+}
+
+TEST_CASE("trans_lines", "[trans]") {
+  CHECK(kepub::trans_lines("安裝後?\n\n  妳好 \n", true) ==
+        std::vector<std::string>{"安装后？", "你好"});
+  CHECK(kepub::trans_lines("Ｑ０\n&amp;", false) ==
+        std::vector<std::string>{"Q0", "&"});
+}
+
+TEST_CASE("traditional_to_simplified", "[trans]") {
+  const auto before = kepub::conversion_stats();
+  CHECK(kepub::traditional_to_simplified("简体中文\n") == "简体中文\n");
+  CHECK(kepub::traditional_to_simplified("繁體中文\n") == "繁体中文\n");
+  // Keys of TWVariantsRev, but everyday Simplified characters
+  CHECK(kepub::traditional_to_simplified("他才吃完饭，就回到床上。\n") ==
+        "他才吃完饭，就回到床上。\n");
+
+  const auto after = kepub::conversion_stats();
+  CHECK(after.skipped_ == before.skipped_ + 2);
+  CHECK(after.converted_ == before.converted_ + 1);
+}
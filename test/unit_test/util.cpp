@@ -1,8 +1,13 @@
+#include <filesystem>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <catch2/catch_test_macros.hpp>
+#include <klib/util.h>
 
+#include "trans.h"
 #include "util.h"
 
 TEST_CASE("check_is_book_id", "[util]") {
@@ -26,6 +31,15 @@ TEST_CASE("volume_name_check", "[util]") {
   REQUIRE_NOTHROW(kepub::volume_name_check("第1卷 "));
 }
 
+TEST_CASE("titles_check", "[util]") {
+  const std::vector<std::string> volume_names = {"第三十二卷 标标标标",
+                                                 "第123话 标题标标标标"};
+  const std::vector<std::string> titles = {"第一章 被俘虏的开始", "第1二3话",
+                                           "第123话 标题标标标标"};
+  REQUIRE_NOTHROW(kepub::titles_check(volume_names, titles));
+  REQUIRE_NOTHROW(kepub::titles_check({}, {}));
+}
+
 TEST_CASE("push_back", "[util]") {
   std::vector<std::string> texts;
   std::string str = "第1卷\u000a";
@@ -33,3 +47,138 @@ TEST_CASE("push_back", "[util]") {
 
   REQUIRE(texts.front() == "第1卷");
 }
+
+TEST_CASE("push_back connect", "[util]") {
+  const std::vector<std::string> lines = {
+      "第一行，", "「第二行", "」", "abc", "第三行", "def", "。", "！"};
+
+  std::vector<std::string> texts;
+  for (const auto &line : lines) {
+    kepub::push_back(texts, line, true, false);
+  }
+
+  REQUIRE(texts == std::vector<std::string>{"第一行，「第二行」",
+                                            "abc 第三行 def。", "！"});
+}
+
+TEST_CASE("lines", "[util]") {
+  const std::string str = "  第一行 \r\n\n\t第二行\nthird";
+  const auto range = kepub::lines(str);
+  const std::vector<std::string> result(std::begin(range), std::end(range));
+
+  REQUIRE(result == std::vector<std::string>{"第一行", "第二行", "third"});
+  REQUIRE(std::empty(std::vector<std::string>(
+      std::begin(kepub::lines(" \n\n")), std::end(kepub::lines(" \n\n")))));
+}
+
+TEST_CASE("append_lines", "[util]") {
+  const std::vector<std::string> lines = {"第一行，", "第二行", "abc", "★"};
+
+  std::vector<std::string> texts;
+  REQUIRE(kepub::append_lines(texts, lines, true) == 6);
+  REQUIRE(texts == std::vector<std::string>{"第一行，第二行 abc", "★"});
+}
+
+TEST_CASE("append_sections", "[util]") {
+  const std::vector<std::string> lines = {"第一行，", "「第二行", "」", "abc",
+                                          "第三行",   "，",       "def", "！"};
+
+  std::vector<std::string> expected;
+  for (const auto &line : lines) {
+    kepub::push_back(expected, line, true);
+  }
+
+  std::vector<std::string> texts;
+  std::vector<std::string> other;
+  const std::span<const std::string> span = lines;
+  const std::vector<kepub::Section> sections = {
+      {&texts, span.first(3)}, {&other, span}, {&texts, span.subspan(3)}};
+
+  REQUIRE(kepub::append_sections(sections, true) == 18);
+  REQUIRE(texts == expected);
+  REQUIRE(other == expected);
+}
+
+TEST_CASE("read_file_to_vec", "[util]") {
+  const std::string file_name = "read_file_to_vec_test.txt";
+  klib::write_file(file_name, false, "  第一行 \n\n\n第二行\r\n");
+
+  REQUIRE(kepub::read_file_to_vec(file_name, false) ==
+          std::vector<std::string>{"第一行", "第二行"});
+
+  klib::write_file(file_name, false, "");
+  REQUIRE(std::empty(kepub::read_file_to_vec(file_name, false)));
+
+  std::filesystem::remove(file_name);
+}
+
+TEST_CASE("read_file_to_vec chunks", "[util]") {
+  const std::string file_name = "read_file_to_vec_chunks_test.txt";
+  // Same as in read_file_to_vec()
+  constexpr std::size_t chunk_size = 1024 * 1024;
+
+  std::string content;
+  const auto fill_to = [&](std::size_t size) {
+    while (std::size(content) + 32 < size) {
+      content.append("第一段 abc，\n");
+    }
+    content.append(size - std::size(content), 'x');
+  };
+
+  // "\r\n" split by the first boundary
+  fill_to(chunk_size - 1);
+  content.append("\r\n");
+  // A line across the second boundary
+  fill_to(2 * chunk_size - 10);
+  content.append("中文中文中文中文\n");
+  // A line longer than a whole chunk
+  for (std::size_t i = 0; i < chunk_size / 2; ++i) {
+    content.append("中");
+  }
+  content.append("\n");
+  // A line ending right before a boundary
+  fill_to(5 * chunk_size - 1);
+  content.append("\n第二段\n\n最后一行");
+
+  std::vector<std::string> expected;
+  for (const auto line : kepub::lines(content)) {
+    if (auto str = kepub::trans_str(line, false); !std::empty(str)) {
+      expected.push_back(std::move(str));
+    }
+  }
+
+  klib::write_file(file_name, false, content);
+  REQUIRE(kepub::read_file_to_vec(file_name, false) == expected);
+
+  std::filesystem::remove(file_name);
+}
+
+TEST_CASE("read_file_to_vec translation", "[util]") {
+  const std::string file_name = "read_file_to_vec_translation_test.txt";
+  // Same as in read_file_to_vec()
+  constexpr std::size_t chunk_size = 1024 * 1024;
+
+  // The first chapter spans two chunks but is converted as a whole, the
+  // second one is Simplified and skipped
+  std::string content = "[WEB] 第一章\n繁體中文\n";
+  while (std::size(content) < chunk_size * 3 / 2) {
+    content.append("第一段 abc，\n");
+  }
+  content.append("[WEB] 第二章\n他才吃完饭，就回到床上。\n");
+
+  // None of the lines needs the rest of its chapter to be converted
+  std::vector<std::string> expected;
+  for (const auto line : kepub::lines(content)) {
+    expected.push_back(kepub::trans_str(line, true));
+  }
+  klib::write_file(file_name, false, content);
+
+  const auto before = kepub::conversion_stats();
+  REQUIRE(kepub::read_file_to_vec(file_name, true) == expected);
+
+  const auto after = kepub::conversion_stats();
+  CHECK(after.converted_ == before.converted_ + 1);
+  CHECK(after.skipped_ == before.skipped_ + 1);
+
+  std::filesystem::remove(file_name);
+}
@@ -1,6 +1,7 @@
 #include <cstddef>
 #include <exception>
 #include <filesystem>
+#include <span>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -10,7 +11,9 @@
 #include <klib/log.h>
 #include <CLI/CLI.hpp>
 
+#include "char_validator.h"
 #include "epub.h"
+#include "trans.h"
 #include "util.h"
 #include "version.h"
 
@@ -71,6 +74,8 @@ int main(int argc, const char *argv[]) try {
   novel.book_info_.name_ = book_name;
 
   auto vec = kepub::read_file_to_vec(file_name, translation);
+  klib::info("Line cache hit ratio: {:.1f}%",
+             kepub::line_cache_stats().hit_ratio() * 100);
   auto size = std::size(vec);
 
   std::string title_prefix = "[WEB] ";
@@ -80,32 +85,49 @@ int main(int argc, const char *argv[]) try {
   std::string volume_prefix = "[VOLUME] ";
   auto volume_prefix_size = std::size(volume_prefix);
 
+  std::vector<std::string> volume_names;
+  std::vector<std::string> titles;
+  std::vector<std::span<const std::string>> chapter_lines;
   for (std::size_t i = 0; i < size; ++i) {
     if (vec[i].starts_with(volume_prefix)) {
       volume_name = vec[i].substr(volume_prefix_size);
-      kepub::volume_name_check(volume_name);
+      volume_names.push_back(volume_name);
       novel.volumes_.emplace_back(volume_name);
     } else if (vec[i].starts_with(title_prefix)) {
       auto title = vec[i].substr(title_prefix_size);
-      kepub::title_check(title);
+      titles.push_back(title);
       ++i;
 
-      std::vector<std::string> content;
-      for (; i < size && !(vec[i].starts_with(title_prefix) ||
-                           vec[i].starts_with(volume_prefix));
-           ++i) {
-        auto line = vec[i];
-        kepub::str_check(line);
-        kepub::push_back(content, line, connect);
+      const auto begin = i;
+      while (i < size && !(vec[i].starts_with(title_prefix) ||
+                           vec[i].starts_with(volume_prefix))) {
+        ++i;
       }
+
+      chapter_lines.push_back(
+          std::span<const std::string>(vec).subspan(begin, i - begin));
       --i;
 
       if (std::empty(novel.volumes_)) {
         novel.volumes_.emplace_back();
       }
-      novel.volumes_.back().chapters_.emplace_back(title, content);
+      novel.volumes_.back().chapters_.emplace_back(title,
+                                                   std::vector<std::string>());
+    }
+  }
+
+  kepub::titles_check(volume_names, titles);
+
+  // Joined in parallel once every chapter is in place
+  std::vector<kepub::Section> sections;
+  for (auto &volume : novel.volumes_) {
+    for (auto &chapter : volume.chapters_) {
+      sections.push_back({&chapter.texts_, chapter_lines[std::size(sections)]});
     }
   }
+  kepub::append_sections(sections, connect);
+
+  kepub::CharValidator::global().report();
 
   kepub::Epub epub;
   // For testing
@@ -1,4 +1,3 @@
-#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <filesystem>
@@ -6,22 +5,21 @@
 #include <string>
 #include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <klib/exception.h>
 #include <klib/log.h>
-#include <klib/unicode.h>
 #include <klib/util.h>
-#include <oneapi/tbb.h>
 #include <CLI/CLI.hpp>
 #include <pugixml.hpp>
 
 #include "aes.h"
+#include "crawler.h"
 #include "geetest.h"
 #include "http.h"
 #include "json.h"
 #include "novel.h"
-#include "progress_bar.h"
 #include "util.h"
 #include "version.h"
 
@@ -52,7 +50,7 @@ bool show_user_info(const Token &token, bool new_version) {
   }
 }
 
-std::optional<Token> try_read_token(bool new_version) {
+std::optional<Token> try_read_token() {
   if (!std::filesystem::exists(token_path)) {
     klib::warn("Login required to access this resource");
     return {};
@@ -68,11 +66,7 @@ std::optional<Token> try_read_token(bool new_version) {
     return {};
   }
 
-  if (show_user_info(token, new_version)) {
-    return token;
-  } else {
-    return {};
-  }
+  return token;
 }
 
 void write_token(const Token &token) {
@@ -114,126 +108,116 @@ LoginInfo login(const std::string &login_name, const std::string &password,
   return info;
 }
 
-kepub::BookInfo get_book_info(const Token &token, const std::string &book_id,
-                              bool new_version) {
-  auto response = http_post("https://app.hbooker.com/book/get_info_by_id",
-                            {{"account", token.account_},
-                             {"login_token", token.login_token_},
-                             {"book_id", book_id}},
-                            new_version);
-  auto info = json_to_book_info(kepub::decrypt_no_iv(response));
-
-  klib::info("Book name: {}", info.name_);
-  klib::info("Author: {}", info.author_);
-  klib::info("Cover url: {}", info.cover_path_);
+class Ciweimao : public kepub::SiteAdapter {
+ public:
+  explicit Ciweimao(bool new_version) : new_version_(new_version) {}
 
-  try {
-    const auto image = http_get_rss(info.cover_path_);
-    const auto image_extension = kepub::image_to_extension(image);
-
-    if (image_extension) {
-      std::string cover_name = "cover" + *image_extension;
-      klib::write_file(cover_name, true, image);
-      klib::info("Cover downloaded successfully: {}", cover_name);
-    } else {
-      klib::warn("Image is not a supported format: {}", info.cover_path_);
+  bool load_session() override {
+    if (auto token = try_read_token(); token.has_value()) {
+      token_ = *token;
+      return true;
     }
-  } catch (const klib::RuntimeError &err) {
-    klib::warn("{}: {}", err.what(), info.cover_path_);
+    return false;
   }
 
-  return info;
-}
+  bool show_user_info() override {
+    return ::show_user_info(token_, new_version_);
+  }
 
-std::vector<kepub::Volume> get_volume_chapter(const Token &token,
-                                              const std::string &book_id,
-                                              bool new_version) {
-  klib::info("Start getting chapter information");
+  std::string session_key() const override {
+    return token_.account_ + "\n" + token_.login_token_;
+  }
 
-  auto response = http_post(
-      "https://app.hbooker.com/chapter/get_updated_chapter_by_division_new",
-      {{"account", token.account_},
-       {"login_token", token.login_token_},
-       {"book_id", book_id}},
-      new_version);
+  void login(const std::string &login_name,
+             const std::string &password) override {
+    token_ = ::login(login_name, password, new_version_).token_;
+    write_token(token_);
+  }
 
-  return json_to_volumes(kepub::decrypt_no_iv(response));
-}
+  std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
+      const std::string &book_id) override {
+    return {get_book_info(book_id), get_volume_chapter(book_id)};
+  }
 
-std::string get_chapter_command(const Token &token,
-                                const std::string &chapter_id,
-                                bool new_version) {
-  auto response = http_post("https://app.hbooker.com/chapter/get_chapter_cmd",
-                            {{"account", token.account_},
-                             {"login_token", token.login_token_},
-                             {"chapter_id", chapter_id}},
-                            new_version);
+  std::string fetch_chapter(const kepub::Chapter &chapter) override {
+    const auto id = std::to_string(chapter.chapter_id_);
+    const auto chapter_command = get_chapter_command(id);
+    auto response = http_post("https://app.hbooker.com/chapter/get_cpt_ifm",
+                              {{"account", token_.account_},
+                               {"login_token", token_.login_token_},
+                               {"chapter_id", id},
+                               {"chapter_command", chapter_command}},
+                              new_version_);
+    const auto encrypt_content_str =
+        json_to_chapter_text(kepub::decrypt_no_iv(response));
+
+    return kepub::decrypt_no_iv(encrypt_content_str, chapter_command);
+  }
 
-  return json_to_chapter_command(kepub::decrypt_no_iv(response));
-}
+  bool is_image(std::string_view line) const override {
+    return line.starts_with("<img src");
+  }
 
-std::optional<std::string> parse_image_url(const std::string &line) {
-  pugi::xml_document doc;
-  doc.load_string(line.c_str());
-  std::string image_url = doc.child("img").attribute("src").as_string();
+  std::optional<std::string> image_url(std::string_view line) const override {
+    pugi::xml_document doc;
+    doc.load_buffer(std::data(line), std::size(line));
+    std::string image_url = doc.child("img").attribute("src").as_string();
 
-  if (std::empty(image_url)) {
-    klib::warn("Invalid image URL: {}", line);
-    return {};
+    if (std::empty(image_url)) {
+      klib::warn("Invalid image URL: {}", line);
+      return {};
+    }
+
+    return image_url;
   }
 
-  return image_url;
-}
+  std::string get_image(const std::string &url) override {
+    return http_get_rss(url);
+  }
 
-std::vector<std::string> get_content(const Token &token,
-                                     std::uint64_t chapter_id,
-                                     bool new_version) {
-  const auto id = std::to_string(chapter_id);
-  const auto chapter_command = get_chapter_command(token, id, new_version);
-  auto response = http_post("https://app.hbooker.com/chapter/get_cpt_ifm",
-                            {{"account", token.account_},
-                             {"login_token", token.login_token_},
-                             {"chapter_id", id},
-                             {"chapter_command", chapter_command}},
-                            new_version);
-  const auto encrypt_content_str =
-      json_to_chapter_text(kepub::decrypt_no_iv(response));
-  const auto content_str =
-      kepub::decrypt_no_iv(encrypt_content_str, chapter_command);
-
-  std::vector<std::string> content;
-  for (auto &line : klib::split_str(content_str, "\n")) {
-    klib::trim(line);
-
-    if (line.starts_with("<img src")) {
-      const auto image_url = parse_image_url(line);
-      if (!image_url) {
-        continue;
-      }
-
-      try {
-        const auto image_stem = kepub::url_to_stem_name(*image_url);
-        const auto image = http_get_rss(*image_url);
-        const auto image_extension = kepub::image_to_extension(image);
-        if (!image_extension) {
-          klib::warn("Image is not a supported format: {}", *image_url);
-          continue;
-        }
-
-        const auto image_name = image_stem + *image_extension;
-        klib::write_file(image_name, true, image);
-        line = "[IMAGE] " + image_name;
-      } catch (const klib::RuntimeError &err) {
-        klib::warn("{}: {}", err.what(), line);
-        continue;
-      }
-    }
+ private:
+  kepub::BookInfo get_book_info(const std::string &book_id) const {
+    auto response = http_post("https://app.hbooker.com/book/get_info_by_id",
+                              {{"account", token_.account_},
+                               {"login_token", token_.login_token_},
+                               {"book_id", book_id}},
+                              new_version_);
+    auto info = json_to_book_info(kepub::decrypt_no_iv(response));
+
+    klib::info("Book name: {}", info.name_);
+    klib::info("Author: {}", info.author_);
+    klib::info("Cover url: {}", info.cover_path_);
 
-    kepub::push_back(content, line);
+    return info;
   }
 
-  return content;
-}
+  std::vector<kepub::Volume> get_volume_chapter(
+      const std::string &book_id) const {
+    klib::info("Start getting chapter information");
+
+    auto response = http_post(
+        "https://app.hbooker.com/chapter/get_updated_chapter_by_division_new",
+        {{"account", token_.account_},
+         {"login_token", token_.login_token_},
+         {"book_id", book_id}},
+        new_version_);
+
+    return json_to_volumes(kepub::decrypt_no_iv(response));
+  }
+
+  std::string get_chapter_command(const std::string &chapter_id) const {
+    auto response = http_post("https://app.hbooker.com/chapter/get_chapter_cmd",
+                              {{"account", token_.account_},
+                               {"login_token", token_.login_token_},
+                               {"chapter_id", chapter_id}},
+                              new_version_);
+
+    return json_to_chapter_command(kepub::decrypt_no_iv(response));
+  }
+
+  bool new_version_;
+  Token token_;
+};
 
 }  // namespace
 
@@ -269,48 +253,12 @@ int main(int argc, const char *argv[]) try {
     klib::warn("This maximum concurrency can be dangerous, please be careful");
   }
 
-  Token token;
-  if (auto may_token = try_read_token(new_version); may_token.has_value()) {
-    token = *may_token;
-  } else {
-    auto login_name = kepub::get_login_name();
-    auto password = kepub::get_password();
-    token = login(login_name, password, new_version).token_;
-    klib::cleanse(password);
-    write_token(token);
-  }
-
-  auto book_info = get_book_info(token, book_id, new_version);
-  auto volumes = get_volume_chapter(token, book_id, new_version);
-
-  std::size_t chapter_count = 0;
-  for (const auto &volume : volumes) {
-    chapter_count += std::size(volume.chapters_);
-  }
-
-  klib::info("Start downloading novel content");
-  kepub::ProgressBar bar(chapter_count, book_info.name_);
-
-  oneapi::tbb::task_arena limited(max_concurrency);
-  oneapi::tbb::task_group task_group;
-
-  for (auto &volume : volumes) {
-    limited.execute([&] {
-      task_group.run([&] {
-        oneapi::tbb::parallel_for_each(
-            volume.chapters_, [&](kepub::Chapter &chapter) {
-              bar.set_postfix_text(chapter.title_);
-              bar.tick();
-              chapter.texts_ =
-                  get_content(token, chapter.chapter_id_, new_version);
-            });
-      });
-    });
-    limited.execute([&] { task_group.wait(); });
-  }
+  kepub::CrawlOptions options;
+  options.max_concurrency_ = max_concurrency;
+  options.session_name_ = "ciweimao";
 
-  kepub::generate_txt(book_info, volumes);
-  klib::info("Novel '{}' download completed", book_info.name_);
+  Ciweimao ciweimao(new_version);
+  kepub::Crawler(ciweimao, options).run(book_id);
 } catch (const klib::Exception &err) {
   klib::error(err.what());
 } catch (const std::exception &err) {
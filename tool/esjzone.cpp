@@ -1,20 +1,20 @@
-#include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <klib/exception.h>
 #include <klib/log.h>
-#include <klib/util.h>
-#include <oneapi/tbb.h>
 #include <CLI/CLI.hpp>
 #include <pugixml.hpp>
 
+#include "crawler.h"
 #include "html.h"
 #include "http.h"
-#include "progress_bar.h"
 #include "trans.h"
 #include "util.h"
 #include "version.h"
@@ -123,71 +123,56 @@ std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
   if (!node.empty()) {
     book_info.cover_path_ = node.attribute("src").as_string();
     klib::info("Cover url: {}", book_info.cover_path_);
-
-    try {
-      const auto image = http_get(book_info.cover_path_, proxy);
-      const auto image_extension = kepub::image_to_extension(image);
-
-      if (image_extension) {
-        std::string cover_name = "cover" + *image_extension;
-        klib::write_file(cover_name, true, image);
-        klib::info("Cover downloaded successfully: {}", cover_name);
-      } else {
-        klib::warn("Image is not a supported format: {}",
-                   book_info.cover_path_);
-      }
-    } catch (const klib::RuntimeError &err) {
-      klib::warn("{}: {}", err.what(), book_info.cover_path_);
-    }
   }
 
   return {book_info, volumes};
 }
 
-std::vector<std::string> get_content(const std::string &url, bool translation,
-                                     const std::string &proxy) {
-  auto doc = get_xml(url, proxy);
+class Esjzone : public kepub::SiteAdapter {
+ public:
+  Esjzone(bool translation, const std::string &proxy)
+      : translation_(translation), proxy_(proxy) {}
 
-  auto node = doc.select_node(
-                     "/html/body/div[@class='offcanvas-wrapper']/section/div/"
-                     "div[@class='col-xl-9 col-lg-8 "
-                     "p-r-30']/div[@class='forum-content mt-3']")
-                  .node();
-  CHECK_NODE(node);
+  std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
+      const std::string &book_id) override {
+    return ::get_info(book_id, translation_, proxy_);
+  }
 
-  std::vector<std::string> result;
-
-  const static std::string image_prefix = "[IMAGE] ";
-  const static auto image_prefix_size = std::size(image_prefix);
-
-  for (const auto &text : kepub::get_node_texts(node)) {
-    for (const auto &line : klib::split_str(text, "\n")) {
-      if (line.starts_with(image_prefix)) {
-        try {
-          const auto image_url = line.substr(image_prefix_size);
-          const auto image = http_get(image_url, proxy);
-          const auto image_extension = kepub::image_to_extension(image);
-          if (!image_extension) {
-            klib::warn("Image is not a supported format: {}", image_url);
-            continue;
-          }
-
-          const auto image_stem = kepub::url_to_stem_name(image_url);
-          auto new_image_name = image_stem + *image_extension;
-          kepub::push_back(result, image_prefix + new_image_name);
-
-          klib::write_file(new_image_name, true, image);
-        } catch (const klib::RuntimeError &err) {
-          klib::warn("{}: {}", err.what(), line);
-        }
-      } else {
-        kepub::push_back(result, kepub::trans_str(line, translation));
-      }
-    }
+  std::string fetch_chapter(const kepub::Chapter &chapter) override {
+    return http_get(chapter.url_, proxy_);
   }
 
-  return result;
-}
+  std::string decode_chapter(std::string content) override {
+    const auto doc = kepub::html_to_xml(content);
+
+    auto node = doc.select_node(
+                       "/html/body/div[@class='offcanvas-wrapper']/section/div/"
+                       "div[@class='col-xl-9 col-lg-8 "
+                       "p-r-30']/div[@class='forum-content mt-3']")
+                    .node();
+    CHECK_NODE(node);
+
+    return kepub::get_node_lines(node).release_buffer();
+  }
+
+  bool is_image(std::string_view line) const override {
+    return line.starts_with(image_prefix);
+  }
+
+  std::optional<std::string> image_url(std::string_view line) const override {
+    return std::string(line.substr(std::size(image_prefix)));
+  }
+
+  std::string get_image(const std::string &url) override {
+    return http_get(url, proxy_);
+  }
+
+ private:
+  constexpr static std::string_view image_prefix = "[IMAGE] ";
+
+  bool translation_;
+  std::string proxy_;
+};
 
 }  // namespace
 
@@ -233,37 +218,14 @@ int main(int argc, const char *argv[]) try {
       "Volume division is not supported at the moment, please handle it "
       "manually");
 
-  kepub::BookInfo book_info;
-  std::vector<kepub::Volume> volumes;
-  std::tie(book_info, volumes) = get_info(book_id, translation, proxy);
-
-  std::size_t chapter_count = 0;
-  for (const auto &volume : volumes) {
-    chapter_count += std::size(volume.chapters_);
-  }
-
-  klib::info("Start downloading novel content");
-  kepub::ProgressBar bar(chapter_count, book_info.name_);
-
-  oneapi::tbb::task_arena limited(max_concurrency);
-  oneapi::tbb::task_group task_group;
-
-  for (auto &volume : volumes) {
-    limited.execute([&] {
-      task_group.run([&] {
-        oneapi::tbb::parallel_for_each(
-            volume.chapters_, [&](kepub::Chapter &chapter) {
-              bar.set_postfix_text(chapter.title_);
-              bar.tick();
-              chapter.texts_ = get_content(chapter.url_, translation, proxy);
-            });
-      });
-    });
-    limited.execute([&] { task_group.wait(); });
-  }
+  kepub::CrawlOptions options;
+  options.max_concurrency_ = max_concurrency;
+  options.normalize_ = true;
+  options.translation_ = translation;
+  options.site_ = "esjzone";
 
-  kepub::generate_txt(book_info, volumes);
-  klib::info("Novel '{}' download completed", book_info.name_);
+  Esjzone esjzone(translation, proxy);
+  kepub::Crawler(esjzone, options).run(book_id);
 } catch (const klib::Exception &err) {
   klib::error(err.what());
 } catch (const std::exception &err) {
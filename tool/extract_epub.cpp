@@ -1,9 +1,8 @@
 #include <exception>
 #include <filesystem>
-#include <fstream>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <klib/archive.h>
@@ -14,7 +13,9 @@
 #include <CLI/CLI.hpp>
 #include <pugixml.hpp>
 
+#include "chapter_store.h"
 #include "epub.h"
+#include "file_writer.h"
 #include "novel.h"
 #include "util.h"
 #include "version.h"
@@ -187,11 +188,19 @@ int main(int argc, const char *argv[]) try {
   auto image_paths = get_image_paths(root_file_path);
   dir.reset();
 
-  std::ostringstream oss;
+  kepub::FileWriter writer(book_name + ".txt");
 
-  oss << "[AUTHOR]"
-      << "\n\n"
-      << author << "\n\n";
+  // The file does not end with an empty line
+  writer.write("[AUTHOR]").write("\n\n").write(author).write('\n');
+  writer.write_if_followed('\n');
+
+  // Also added to the chapter store, if there is one
+  const auto store = kepub::ChapterStore::instance();
+  kepub::BookInfo book_info;
+  book_info.name_ = book_name;
+  book_info.author_ = author;
+  std::vector<kepub::Volume> volumes;
+  std::vector<std::string> postscript;
 
   auto path_prefix =
       (std::filesystem::path(book_name) / root_file_path).parent_path();
@@ -201,30 +210,38 @@ int main(int argc, const char *argv[]) try {
       continue;
     }
 
+    // Null if the lines are not kept
+    std::vector<std::string> *texts = nullptr;
     if (file_path.ends_with("introduction.xhtml")) {
-      oss << "[INTRO]"
-          << "\n\n";
+      writer.write("[INTRO]").write("\n\n");
+      texts = &book_info.introduction_;
     } else if (file_path.ends_with("postscript.xhtml")) {
-      oss << "[POST]"
-          << "\n\n";
+      writer.write("[POST]").write("\n\n");
+      texts = &postscript;
     } else if (file_path.find("volume") != std::string::npos) {
-      oss << "[VOLUME] " << chapter.title_ << "\n\n";
+      writer.write("[VOLUME] ").write(chapter.title_).write("\n\n");
+      volumes.emplace_back(chapter.title_);
     } else {
-      oss << "[WEB] " << chapter.title_ << "\n\n";
+      writer.write("[WEB] ").write(chapter.title_).write("\n\n");
+      if (std::empty(volumes)) {
+        volumes.emplace_back();
+      }
+      auto &stored = volumes.back().chapters_.emplace_back();
+      stored.title_ = chapter.title_;
+      texts = &stored.texts_;
     }
 
     for (const auto &line : chapter.texts_) {
-      oss << line << '\n';
+      writer.write(line).write('\n');
     }
-    oss << '\n';
-  }
+    writer.write_if_followed('\n');
 
-  std::string str = oss.str();
-  // '\n'
-  str.pop_back();
+    if (store && texts) {
+      *texts = std::move(chapter.texts_);
+    }
+  }
 
-  std::ofstream ofs(book_name + ".txt");
-  ofs << str << std::flush;
+  writer.close();
 
   for (const auto &image_path : image_paths) {
     auto path = path_prefix / image_path;
@@ -241,6 +258,11 @@ int main(int argc, const char *argv[]) try {
     std::filesystem::copy(path, to_path);
   }
 
+  // The images are stored from the current working directory
+  if (store) {
+    store->add_book(book_info, volumes, postscript);
+  }
+
   kepub::remove_file_or_dir(book_name);
 } catch (const klib::Exception &err) {
   klib::error(err.what());
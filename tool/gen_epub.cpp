@@ -2,7 +2,9 @@
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <klib/archive.h>
@@ -10,6 +12,8 @@
 #include <klib/log.h>
 #include <CLI/CLI.hpp>
 
+#include "book_file.h"
+#include "char_validator.h"
 #include "epub.h"
 #include "trans.h"
 #include "util.h"
@@ -34,13 +38,147 @@ void compress_dir_to_epub(const std::string &dir_name, bool remove,
   }
 }
 
+// Returns the number of CJK characters
+std::int32_t read_txt(const std::string &file_name, bool translation,
+                      bool connect, bool no_check, kepub::Novel &novel) {
+  auto vec = kepub::read_file_to_vec(file_name, translation);
+  klib::info("Line cache hit ratio: {:.1f}%",
+             kepub::line_cache_stats().hit_ratio() * 100);
+  auto size = std::size(vec);
+
+  std::string title_prefix = "[WEB] ";
+  auto title_prefix_size = std::size(title_prefix);
+
+  std::string volume_prefix = "[VOLUME] ";
+  auto volume_prefix_size = std::size(volume_prefix);
+
+  std::string author_prefix = "[AUTHOR]";
+  std::string introduction_prefix = "[INTRO]";
+  std::string postscript_prefix = "[POST]";
+
+  auto is_prefix = [&](const std::string &line) {
+    return line.starts_with(author_prefix) ||
+           line.starts_with(introduction_prefix) ||
+           line.starts_with(postscript_prefix) ||
+           line.starts_with(title_prefix) || line.starts_with(volume_prefix);
+  };
+
+  // Joined in parallel once every chapter is in place, a null target is the
+  // next chapter
+  std::vector<
+      std::pair<std::vector<std::string> *, std::span<const std::string>>>
+      pending;
+
+  // Checked together once every chapter is in place
+  std::vector<std::string> volume_names;
+  std::vector<std::string> titles;
+
+  // Queues the lines up to the next prefix, i is left at that prefix
+  auto append_section = [&](std::size_t &i, std::vector<std::string> *texts) {
+    const auto begin = i;
+    while (i < size && !is_prefix(vec[i])) {
+      ++i;
+    }
+
+    pending.emplace_back(
+        texts, std::span<const std::string>(vec).subspan(begin, i - begin));
+  };
+
+  for (std::size_t i = 0; i < size; ++i) {
+    if (vec[i].starts_with(author_prefix)) {
+      ++i;
+
+      novel.book_info_.author_ = vec[i];
+      klib::info("Author: {}", novel.book_info_.author_);
+    } else if (vec[i].starts_with(introduction_prefix)) {
+      ++i;
+
+      append_section(i, &novel.book_info_.introduction_);
+      --i;
+    } else if (vec[i].starts_with(postscript_prefix)) {
+      ++i;
+
+      append_section(i, &novel.postscript_);
+      --i;
+    } else if (vec[i].starts_with(volume_prefix)) {
+      auto volume_name = vec[i].substr(volume_prefix_size);
+      volume_names.push_back(volume_name);
+
+      novel.volumes_.emplace_back(volume_name);
+    } else if (vec[i].starts_with(title_prefix)) {
+      auto title = vec[i].substr(title_prefix_size);
+      titles.push_back(title);
+
+      ++i;
+
+      append_section(i, nullptr);
+      --i;
+
+      if (std::empty(novel.volumes_)) {
+        novel.volumes_.emplace_back();
+      }
+      novel.volumes_.back().chapters_.emplace_back(title,
+                                                   std::vector<std::string>());
+    }
+  }
+
+  if (!no_check) {
+    kepub::titles_check(volume_names, titles);
+  }
+
+  std::vector<kepub::Section> sections;
+  auto volume = std::begin(novel.volumes_);
+  std::size_t chapter = 0;
+  for (auto [texts, lines] : pending) {
+    if (!texts) {
+      while (chapter == std::size(volume->chapters_)) {
+        ++volume;
+        chapter = 0;
+      }
+      texts = &volume->chapters_[chapter++].texts_;
+    }
+    sections.push_back({texts, lines});
+  }
+  return kepub::append_sections(sections, connect, !no_check);
+}
+
+// Already normalized and joined by the crawler, so translation and connect do
+// not apply
+std::int32_t read_book_file(const std::string &file_name, bool no_check,
+                            kepub::Novel &novel) {
+  auto book = kepub::BookFile(file_name).novel();
+
+  novel.book_info_.author_ = std::move(book.book_info_.author_);
+  klib::info("Author: {}", novel.book_info_.author_);
+  novel.book_info_.introduction_ = std::move(book.book_info_.introduction_);
+  novel.postscript_ = std::move(book.postscript_);
+  novel.volumes_ = std::move(book.volumes_);
+
+  if (!no_check) {
+    std::vector<std::string> volume_names;
+    std::vector<std::string> titles;
+    for (const auto &volume : novel.volumes_) {
+      if (!std::empty(volume.title_)) {
+        volume_names.push_back(volume.title_);
+      }
+      for (const auto &chapter : volume.chapters_) {
+        titles.push_back(chapter.title_);
+      }
+    }
+    kepub::titles_check(volume_names, titles);
+  }
+
+  return kepub::check_novel(novel, !no_check);
+}
+
 int main(int argc, const char *argv[]) try {
   CLI::App app;
   app.footer(kepub::footer_str());
   app.set_version_flag("-v,--version", kepub::version_str());
 
   std::string file_name;
-  app.add_option("file", file_name, "TXT file to be processed")->required();
+  app.add_option("file", file_name, "TXT or book file to be processed")
+      ->required();
 
   bool only_check = false;
   app.add_flag("-o,--only-check", only_check,
@@ -84,7 +222,13 @@ int main(int argc, const char *argv[]) try {
     std::exit(EXIT_SUCCESS);
   }
 
-  kepub::check_is_txt_file(file_name);
+  const auto from_book_file = std::filesystem::path(file_name).extension() ==
+                              kepub::BookFile::extension;
+  if (from_book_file) {
+    kepub::check_file_exist(file_name);
+  } else {
+    kepub::check_is_txt_file(file_name);
+  }
   auto book_name = kepub::trans_str(kepub::stem(file_name), translation);
   klib::info("Book name: {}", book_name);
 
@@ -148,95 +292,12 @@ int main(int argc, const char *argv[]) try {
     epub.set_datetime(datetime);
   }
 
-  auto vec = kepub::read_file_to_vec(file_name, translation);
-  auto size = std::size(vec);
-
-  std::string title_prefix = "[WEB] ";
-  auto title_prefix_size = std::size(title_prefix);
-
-  std::string volume_prefix = "[VOLUME] ";
-  auto volume_prefix_size = std::size(volume_prefix);
-
-  std::string author_prefix = "[AUTHOR]";
-  std::string introduction_prefix = "[INTRO]";
-  std::string postscript_prefix = "[POST]";
-
-  std::int32_t word_count = 0;
-
-  auto is_prefix = [&](const std::string &line) {
-    return line.starts_with(author_prefix) ||
-           line.starts_with(introduction_prefix) ||
-           line.starts_with(postscript_prefix) ||
-           line.starts_with(title_prefix) || line.starts_with(volume_prefix);
-  };
-
-  for (std::size_t i = 0; i < size; ++i) {
-    if (vec[i].starts_with(author_prefix)) {
-      ++i;
-
-      novel.book_info_.author_ = vec[i];
-      klib::info("Author: {}", novel.book_info_.author_);
-    } else if (vec[i].starts_with(introduction_prefix)) {
-      ++i;
-
-      for (; i < size && !is_prefix(vec[i]); ++i) {
-        auto line = vec[i];
-        if (!no_check) {
-          kepub::str_check(line);
-        }
-
-        word_count += kepub::str_size(line);
-        kepub::push_back(novel.book_info_.introduction_, line, connect,
-                         !no_check);
-      }
-      --i;
-    } else if (vec[i].starts_with(postscript_prefix)) {
-      ++i;
-
-      for (; i < size && !is_prefix(vec[i]); ++i) {
-        auto line = vec[i];
-        if (!no_check) {
-          kepub::str_check(line);
-        }
-
-        word_count += kepub::str_size(line);
-        kepub::push_back(novel.postscript_, line, connect, !no_check);
-      }
-      --i;
-    } else if (vec[i].starts_with(volume_prefix)) {
-      auto volume_name = vec[i].substr(volume_prefix_size);
-      if (!no_check) {
-        kepub::volume_name_check(volume_name);
-      }
-
-      novel.volumes_.emplace_back(volume_name);
-    } else if (vec[i].starts_with(title_prefix)) {
-      auto title = vec[i].substr(title_prefix_size);
-      if (!no_check) {
-        kepub::title_check(title);
-      }
-
-      ++i;
-
-      std::vector<std::string> content;
-      for (; i < size && !is_prefix(vec[i]); ++i) {
-        auto line = vec[i];
-        if (!no_check) {
-          kepub::str_check(line);
-        }
-
-        word_count += kepub::str_size(line);
-        kepub::push_back(content, line, connect, !no_check);
-      }
-      --i;
-
-      if (std::empty(novel.volumes_)) {
-        novel.volumes_.emplace_back();
-      }
-      novel.volumes_.back().chapters_.emplace_back(title, content);
-    }
-  }
+  const auto word_count =
+      from_book_file
+          ? read_book_file(file_name, no_check, novel)
+          : read_txt(file_name, translation, connect, no_check, novel);
 
+  kepub::CharValidator::global().report();
   klib::info("Total words: {}", word_count);
 
   if (only_check) {
@@ -1,6 +1,11 @@
+#include <atomic>
 #include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <klib/exception.h>
@@ -8,13 +13,12 @@
 #include <klib/util.h>
 #include <CLI/CLI.hpp>
 #include <boost/algorithm/string.hpp>
-#include <pugixml.hpp>
 
 #include "aes.h"
+#include "crawler.h"
 #include "html.h"
 #include "http.h"
 #include "json.h"
-#include "trans.h"
 #include "util.h"
 #include "version.h"
 
@@ -42,7 +46,7 @@ bool show_user_info(const std::string &security_key, const std::string &proxy) {
   }
 }
 
-std::optional<std::string> try_read_security_key(const std::string &proxy) {
+std::optional<std::string> try_read_security_key() {
   if (!std::filesystem::exists(security_key_path)) {
     klib::warn("Login required to access this resource");
     return {};
@@ -56,11 +60,7 @@ std::optional<std::string> try_read_security_key(const std::string &proxy) {
     return {};
   }
 
-  if (show_user_info(security_key, proxy)) {
-    return security_key;
-  } else {
-    return {};
-  }
+  return security_key;
 }
 
 void write_security_key(const std::string &security_key) {
@@ -77,63 +77,99 @@ std::string login(const std::string &login_name, const std::string &password,
   return info.security_key_;
 }
 
-pugi::xml_document get_xml(const std::string &url,
-                           const std::string &security_key,
-                           const std::string &proxy) {
-  auto response = http_get(url, security_key, proxy);
-  return kepub::html_to_xml(response);
-}
+class Lightnovel : public kepub::SiteAdapter {
+ public:
+  explicit Lightnovel(const std::string &proxy) : proxy_(proxy) {}
 
-std::vector<std::string> get_content(const pugi::xml_document &doc,
-                                     bool translation,
-                                     const std::string &proxy) {
-  auto node = doc.select_node(
-                     "/html/body/div/div/div/div[@class='layout-container']/"
-                     "div/div/div[@class='left-contents']/article/"
-                     "div[@class='article-content']/article")
-                  .node();
-  CHECK_NODE(node);
-
-  std::vector<std::string> result;
-
-  static std::int32_t count = 0;
-  const static std::string image_prefix = "[IMAGE] ";
-  const static auto image_prefix_size = std::size(image_prefix);
-
-  for (const auto &text : kepub::get_node_texts(node, true)) {
-    for (const auto &line : klib::split_str(text, "\n")) {
-      if (line.starts_with(image_prefix)) {
-        try {
-          const auto image_url = line.substr(image_prefix_size);
-          const auto image = http_get_rss(image_url, proxy);
-          const auto image_extension = kepub::image_to_extension(image);
-          if (!image_extension) {
-            klib::warn("Image is not a supported format: {}", image_url);
-            continue;
-          }
-
-          std::string new_image_name;
-          if (count == 0) {
-            new_image_name = "cover" + *image_extension;
-            ++count;
-          } else {
-            new_image_name = kepub::num_to_str(count++) + *image_extension;
-            kepub::push_back(result, image_prefix + new_image_name);
-          }
-
-          klib::write_file(new_image_name, true, image);
-          klib::info("Image download complete: {}", new_image_name);
-        } catch (const klib::RuntimeError &err) {
-          klib::warn("{}: {}", err.what(), line);
-        }
-      } else {
-        kepub::push_back(result, kepub::trans_str(line, translation));
-      }
+  bool load_session() override {
+    if (auto security_key = try_read_security_key(); security_key.has_value()) {
+      security_key_ = *security_key;
+      return true;
     }
+    return false;
   }
 
-  return result;
-}
+  bool show_user_info() override {
+    return ::show_user_info(security_key_, proxy_);
+  }
+
+  std::string session_key() const override { return security_key_; }
+
+  void login(const std::string &login_name,
+             const std::string &password) override {
+    security_key_ = ::login(login_name, password, proxy_);
+    write_security_key(security_key_);
+  }
+
+  // The whole book is a single article, the book name is its first line
+  std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
+      const std::string &book_id) override {
+    const std::string url = "https://www.lightnovel.us/cn/detail/" + book_id;
+    klib::info("Download novel from {}", url);
+
+    std::vector<kepub::Volume> volumes(1);
+    volumes.front().chapters_.emplace_back(url, "");
+
+    return {kepub::BookInfo(), std::move(volumes)};
+  }
+
+  std::string fetch_chapter(const kepub::Chapter &chapter) override {
+    return http_get(chapter.url_, security_key_, proxy_);
+  }
+
+  std::string decode_chapter(std::string content) override {
+    const auto doc = kepub::html_to_xml(content);
+
+    auto node = doc.select_node(
+                       "/html/body/div/div/div/div[@class='layout-container']/"
+                       "div/div/div[@class='left-contents']/article/"
+                       "div[@class='article-content']/article")
+                    .node();
+    CHECK_NODE(node);
+
+    return kepub::get_node_lines(node, true).release_buffer();
+  }
+
+  bool is_image(std::string_view line) const override {
+    return line.starts_with(image_prefix);
+  }
+
+  std::optional<std::string> image_url(std::string_view line) const override {
+    return std::string(line.substr(std::size(image_prefix)));
+  }
+
+  std::string get_image(const std::string &url) override {
+    return http_get_rss(url, proxy_);
+  }
+
+  // The first image is the cover, the others are numbered in the order they
+  // are downloaded. Called from the download threads
+  std::string image_stem(const std::string &) override {
+    if (const auto count = image_count_.fetch_add(1); count != 0) {
+      return kepub::num_to_str(count);
+    }
+    return "cover";
+  }
+
+  void write(kepub::BookInfo &book_info,
+             std::vector<kepub::Volume> &volumes) override {
+    const auto &content = volumes.front().chapters_.front().texts_;
+    if (std::empty(content)) {
+      klib::error("No content");
+    }
+    book_info.name_ = content.front();
+
+    klib::write_file(book_info.name_ + ".txt", false,
+                     boost::join(content, "\n") + "\n");
+  }
+
+ private:
+  constexpr static std::string_view image_prefix = "[IMAGE] ";
+
+  std::string proxy_;
+  std::string security_key_;
+  std::atomic<std::int32_t> image_count_ = 0;
+};
 
 }  // namespace
 
@@ -162,30 +198,14 @@ int main(int argc, const char *argv[]) try {
     klib::info("Use proxy: {}", proxy);
   }
 
-  std::string security_key;
-  if (auto may_security_key = try_read_security_key(proxy);
-      may_security_key.has_value()) {
-    security_key = *may_security_key;
-  } else {
-    auto login_name = kepub::get_login_name();
-    auto password = kepub::get_password();
-    security_key = login(login_name, password, proxy);
-    klib::cleanse(password);
-    write_security_key(security_key);
-  }
-
-  const std::string url = "https://www.lightnovel.us/cn/detail/" + book_id;
-  klib::info("Download novel from {}", url);
-
-  klib::info("Start downloading novel content");
-  auto doc = get_xml(url, security_key, proxy);
-
-  auto content = get_content(doc, translation, proxy);
-  auto book_name = content.front();
+  kepub::CrawlOptions options;
+  options.session_name_ = "lightnovel";
+  options.normalize_ = true;
+  options.translation_ = translation;
+  options.site_ = "lightnovel";
 
-  klib::write_file(book_name + ".txt", false,
-                   boost::join(content, "\n") + "\n");
-  klib::info("Novel '{}' download completed", book_name);
+  Lightnovel lightnovel(proxy);
+  kepub::Crawler(lightnovel, options).run(book_id);
 } catch (const klib::Exception &err) {
   klib::error(err.what());
 } catch (const std::exception &err) {
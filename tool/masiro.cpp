@@ -1,25 +1,24 @@
-#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include <klib/exception.h>
 #include <klib/log.h>
 #include <klib/url.h>
-#include <klib/util.h>
-#include <oneapi/tbb.h>
 #include <CLI/CLI.hpp>
 #include <gsl/assert>
 #include <pugixml.hpp>
 
+#include "crawler.h"
 #include "html.h"
 #include "http.h"
 #include "json.h"
-#include "progress_bar.h"
 #include "trans.h"
 #include "util.h"
 #include "version.h"
@@ -38,6 +37,23 @@ pugi::xml_document get_xml(const std::string &url, const std::string &proxy) {
   return kepub::html_to_xml(response);
 }
 
+// Pages that need login redirect to the login page. The title of a chapter
+// page is the chapter name, so the page is only looked at when the node that
+// was expected is missing
+void check_login_page(const pugi::xml_document &doc,
+                      const pugi::xml_node &node) {
+  if (!node.empty()) [[likely]] {
+    return;
+  }
+
+  const auto title = doc.select_node("/html/head/title").node();
+  if (!doc.select_node("//div[@id='login']/form").node().empty() ||
+      std::string_view(title.text().as_string()).find("登录") !=
+          std::string_view::npos) {
+    throw kepub::LoginExpiredError("Login expired");
+  }
+}
+
 std::optional<std::string> get_user_info(const std::string &proxy) {
   auto doc = get_xml("https://masiro.me/admin/userCenterShow", proxy);
   auto node = doc.select_node("/html/head/title").node();
@@ -117,17 +133,18 @@ std::tuple<std::string, kepub::BookInfo, std::vector<kepub::Volume>> get_info(
   klib::info("Download novel from {}", url);
   const auto doc = get_xml(url, proxy);
 
-  auto node = doc.select_node("/html/head/meta[@name='csrf-token']").node();
+  auto node = doc.select_node(
+                     "/html/body/div/div[@id='pjax-container']/div/"
+                     "section[@class='content']/div[1]/div/div/"
+                     "div[@class='box-body z-i']/div[@class='novel-title']")
+                  .node();
+  check_login_page(doc, node);
   CHECK_NODE(node);
-  std::string token = node.attribute("content").as_string();
+  book_info.name_ = kepub::trans_str(node.text().as_string(), translation);
 
-  node = doc.select_node(
-                "/html/body/div/div[@id='pjax-container']/div/"
-                "section[@class='content']/div[1]/div/div/"
-                "div[@class='box-body z-i']/div[@class='novel-title']")
-             .node();
+  node = doc.select_node("/html/head/meta[@name='csrf-token']").node();
   CHECK_NODE(node);
-  book_info.name_ = kepub::trans_str(node.text().as_string(), translation);
+  std::string token = node.attribute("content").as_string();
 
   node = doc.select_node(
                 "/html/body/div/div[@id='pjax-container']/div/"
@@ -144,9 +161,9 @@ std::tuple<std::string, kepub::BookInfo, std::vector<kepub::Volume>> get_info(
                 "div[@class='box-footer z-i']/div")
              .node();
   CHECK_NODE(node);
-  for (const auto &child : klib::split_str(node.text().as_string(), "\n")) {
+  for (const auto line : kepub::lines(node.text().as_string())) {
     kepub::push_back(book_info.introduction_,
-                     kepub::trans_str(child, translation));
+                     kepub::trans_str(line, translation));
   }
 
   node = doc.select_node(
@@ -203,21 +220,6 @@ std::tuple<std::string, kepub::BookInfo, std::vector<kepub::Volume>> get_info(
   klib::info("Author: {}", book_info.author_);
   klib::info("Cover url: {}", book_info.cover_path_);
 
-  try {
-    const auto image = http_get(book_info.cover_path_, proxy);
-    const auto image_extension = kepub::image_to_extension(image);
-
-    if (image_extension) {
-      std::string cover_name = "cover" + *image_extension;
-      klib::write_file(cover_name, true, image);
-      klib::info("Cover downloaded successfully: {}", cover_name);
-    } else {
-      klib::warn("Image is not a supported format: {}", book_info.cover_path_);
-    }
-  } catch (const klib::RuntimeError &err) {
-    klib::warn("{}: {}", err.what(), book_info.cover_path_);
-  }
-
   return {token, book_info, volumes};
 }
 
@@ -234,54 +236,81 @@ void pay(const std::string &chapter_url, std::int32_t chapter_pay,
        {"object_id", get_chapter_id(chapter_url)},
        {"cost", std::to_string(chapter_pay)}},
       {{"X-Requested-With", "XMLHttpRequest"}, {"X-CSRF-Token", token}}, proxy);
+
+  // Redirected to the login page instead of answered in JSON
+  if (const auto begin = response.find_first_not_of(" \t\r\n");
+      begin != std::string::npos && response[begin] == '<') [[unlikely]] {
+    check_login_page(kepub::html_to_xml(response), {});
+  }
   json_base(std::move(response));
 }
 
-std::vector<std::string> get_content(const std::string &url, bool translation,
-                                     const std::string &proxy) {
-  auto doc = get_xml(url, proxy);
+class Masiro : public kepub::SiteAdapter {
+ public:
+  Masiro(bool translation, const std::string &proxy)
+      : translation_(translation), proxy_(proxy) {}
 
-  auto node = doc.select_node(
-                     "/html/body/div/div[@id='pjax-container']/div/"
-                     "section[@class='content']/div[1]/div/div/"
-                     "div[@class='box-body nvl-content']")
-                  .node();
-  CHECK_NODE(node);
+  bool show_user_info() override { return ::show_user_info(proxy_); }
 
-  std::vector<std::string> result;
-
-  const static std::string image_prefix = "[IMAGE] ";
-  const static auto image_prefix_size = std::size(image_prefix);
-
-  for (const auto &text : kepub::get_node_texts(node)) {
-    for (const auto &line : klib::split_str(text, "\n")) {
-      if (line.starts_with(image_prefix)) {
-        try {
-          const auto image_url =
-              remove_image_url_quality(line.substr(image_prefix_size));
-          const auto image = http_get(image_url, proxy);
-          const auto image_extension = kepub::image_to_extension(image);
-          if (!image_extension) {
-            klib::warn("Image is not a supported format: {}", image_url);
-            continue;
-          }
+  void login(const std::string &login_name,
+             const std::string &password) override {
+    ::login(login_name, password, proxy_);
+  }
 
-          const auto image_stem = kepub::url_to_stem_name(image_url);
-          auto new_image_name = image_stem + *image_extension;
-          kepub::push_back(result, image_prefix + new_image_name);
+  std::pair<kepub::BookInfo, std::vector<kepub::Volume>> get_info(
+      const std::string &book_id) override {
+    auto [token, book_info, volumes] =
+        ::get_info(book_id, translation_, proxy_);
+    token_ = std::move(token);
 
-          klib::write_file(new_image_name, true, image);
-        } catch (const klib::RuntimeError &err) {
-          klib::warn("{}: {}", err.what(), line);
-        }
-      } else {
-        kepub::push_back(result, kepub::trans_str(line, translation));
-      }
+    return {std::move(book_info), std::move(volumes)};
+  }
+
+  void unlock_chapter(const kepub::Chapter &chapter) override {
+    if (chapter.pay_ > 0) {
+      pay(chapter.url_, chapter.pay_, token_, proxy_);
     }
   }
 
-  return result;
-}
+  std::string fetch_chapter(const kepub::Chapter &chapter) override {
+    return http_get(chapter.url_, proxy_);
+  }
+
+  std::string decode_chapter(std::string content) override {
+    const auto doc = kepub::html_to_xml(content);
+
+    const auto node = doc.select_node(
+                             "/html/body/div/div[@id='pjax-container']/div/"
+                             "section[@class='content']/div[1]/div/div/"
+                             "div[@class='box-body nvl-content']")
+                          .node();
+    check_login_page(doc, node);
+    CHECK_NODE(node);
+
+    return kepub::get_node_lines(node).release_buffer();
+  }
+
+  bool is_image(std::string_view line) const override {
+    return line.starts_with(image_prefix);
+  }
+
+  std::optional<std::string> image_url(std::string_view line) const override {
+    return remove_image_url_quality(
+        std::string(line.substr(std::size(image_prefix))));
+  }
+
+  std::string get_image(const std::string &url) override {
+    return http_get(url, proxy_);
+  }
+
+ private:
+  constexpr static std::string_view image_prefix = "[IMAGE] ";
+
+  bool translation_;
+  std::string proxy_;
+  // CSRF token of the book page, used when paying for chapters
+  std::string token_;
+};
 
 }  // namespace
 
@@ -320,49 +349,15 @@ int main(int argc, const char *argv[]) try {
     klib::warn("This maximum concurrency can be dangerous, please be careful");
   }
 
-  if (!show_user_info(proxy)) {
-    const auto login_name = kepub::get_login_name();
-    auto password = kepub::get_password();
-    login(login_name, password, proxy);
-    klib::cleanse(password);
-  }
-
-  std::string token;
-  kepub::BookInfo book_info;
-  std::vector<kepub::Volume> volumes;
-  std::tie(token, book_info, volumes) = get_info(book_id, translation, proxy);
-
-  std::size_t chapter_count = 0;
-  for (const auto &volume : volumes) {
-    chapter_count += std::size(volume.chapters_);
-  }
-
-  klib::info("Start downloading novel content");
-  kepub::ProgressBar bar(chapter_count, book_info.name_);
-
-  oneapi::tbb::task_arena limited(max_concurrency);
-  oneapi::tbb::task_group task_group;
-
-  for (auto &volume : volumes) {
-    limited.execute([&] {
-      task_group.run([&] {
-        oneapi::tbb::parallel_for_each(
-            volume.chapters_, [&](kepub::Chapter &chapter) {
-              bar.set_postfix_text(chapter.title_);
-              bar.tick();
-
-              if (chapter.pay_ > 0) {
-                pay(chapter.url_, chapter.pay_, token, proxy);
-              }
-              chapter.texts_ = get_content(chapter.url_, translation, proxy);
-            });
-      });
-    });
-    limited.execute([&] { task_group.wait(); });
-  }
+  kepub::CrawlOptions options;
+  options.max_concurrency_ = max_concurrency;
+  options.session_name_ = "masiro";
+  options.normalize_ = true;
+  options.translation_ = translation;
+  options.site_ = "masiro";
 
-  kepub::generate_txt(book_info, volumes);
-  klib::info("Novel '{}' download completed", book_info.name_);
+  Masiro masiro(translation, proxy);
+  kepub::Crawler(masiro, options).run(book_id);
 } catch (const klib::Exception &err) {
   klib::error(err.what());
 } catch (const std::exception &err) {